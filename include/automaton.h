@@ -0,0 +1,295 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef AUTOMATON_H
+#define AUTOMATON_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <array>
+
+#include "grid.h"
+
+
+enum Neighborhood {
+    NEIGHBORHOOD_MOORE, NEIGHBORHOOD_VON_NEUMANN
+};
+
+
+/**
+ *  @return Bitset of the neighbor counts in [lo:hi], for the birth and
+ *          survive parameters of Automaton
+ */
+constexpr uint64_t automaton_range(int lo, int hi) {
+    return (hi < lo) ? 0 : (((hi >= 63) ? ~0ull : ((1ull << (hi + 1)) - 1)) & ~((1ull << lo) - 1));
+}
+
+
+/**
+ *  @return Number of cells in the neighborhood, the centre excluded
+ */
+constexpr int automaton_neighbors(Neighborhood n, int radius) {
+    int count = 0;
+
+    for (int i = -radius; i <= radius; i++) {
+        for (int j = -radius; j <= radius; j++) {
+            for (int k = -radius; k <= radius; k++) {
+                int d = (i < 0 ? -i : i) + (j < 0 ? -j : j) + (k < 0 ? -k : k);
+                if (d != 0 && (n == NEIGHBORHOOD_MOORE || d <= radius)) count++;
+            }
+        }
+    }
+    return count;
+}
+
+
+/**
+ *  Rule agnostic interface to an Automaton, what the registry hands out.
+ */
+class CellularAutomaton {
+public:
+    int x;
+    int y;
+    int z;
+
+    virtual ~CellularAutomaton() {}
+
+    /**
+     *  Replaces the cells with those of a grid, solid cells become alive.
+     *
+     *  @param grid     Grid of the same size as the automaton
+     */
+    virtual void load(Grid *grid) = 0;
+
+    /**
+     *  Writes every non-dead cell into a grid as solid and recounts its bricks.
+     *
+     *  @param grid     Grid of the same size as the automaton
+     */
+    virtual void store(Grid *grid) = 0;
+
+    /**
+     *  Advances the automaton by one generation.
+     */
+    virtual void step() = 0;
+
+    /**
+     *  @return Number of living cells, dying cells are not counted
+     */
+    virtual long population() = 0;
+};
+
+
+/**
+ *  A 3D cellular automaton with its rule fixed at compile time. Cells
+ *  outside the grid count as dead.
+ *
+ *  With two states a dead cell is born when its number of living neighbors
+ *  is in Birth and a living cell survives when it is in Survive. With more
+ *  states, a living cell that does not survive decays through the states
+ *  2 .. States - 1 before dying and only living cells (state 1) are counted.
+ *
+ *  The rule is baked into a small table indexed by state and count, so the
+ *  inner loop is the same unrolled gather and one load for every rule.
+ *
+ *  @param Birth        Bitset of the counts that give birth, see automaton_range()
+ *  @param Survive      Bitset of the counts that keep a cell alive
+ *  @param N            Shape of the neighborhood
+ *  @param Radius       Radius of the neighborhood
+ *  @param States       Number of states, 2 for Life-like rules
+ */
+template <uint64_t Birth, uint64_t Survive, Neighborhood N, int Radius, int States>
+class Automaton : public CellularAutomaton {
+private:
+    static constexpr int NEIGHBORS = automaton_neighbors(N, Radius);
+
+    uint8_t *m_next;
+    std::array<int, NEIGHBORS> m_offsets;
+    std::array<uint8_t, States * (NEIGHBORS + 1)> m_rule;
+    int m_py, m_pz;
+
+    /**
+     *  @return Index of cell x, y, z in the buffers padded by Radius dead
+     *          cells on every face
+     */
+    size_t index(int x, int y, int z) const {
+        return ((((size_t) (x + Radius) * this->m_py) + y + Radius) * this->m_pz) + z + Radius;
+    }
+
+    static uint8_t alive(uint8_t state) {
+        return (States == 2) ? state : (uint8_t) (state == 1);
+    }
+public:
+    uint8_t *m_current;
+
+    /**
+     *  Constructs an automaton with every cell dead. Sizes Grid::fits()
+     *  rejects give an empty 0 x 0 x 0 automaton.
+     *
+     *  @param x    Size of the x dimension
+     *  @param y    Size of the y dimension
+     *  @param z    Size of the z dimension
+     */
+    Automaton(int x, int y, int z) {
+        size_t n;
+        int i, j, k, s, c;
+
+        static_assert(States >= 2 && States <= 256, "Automaton needs 2 to 256 states");
+        static_assert(Radius >= 1, "Automaton needs a radius of at least 1");
+
+        if (!Grid::fits(x, y, z)) x = y = z = 0;
+
+        this->x = x;
+        this->y = y;
+        this->z = z;
+        this->m_py = y + (2 * Radius);
+        this->m_pz = z + (2 * Radius);
+
+        n = (size_t) (x + (2 * Radius)) * this->m_py * this->m_pz;
+        this->m_current = new uint8_t[n]();
+        this->m_next = new uint8_t[n]();
+
+        for (c = 0, i = -Radius; i <= Radius; i++) {
+            for (j = -Radius; j <= Radius; j++) {
+                for (k = -Radius; k <= Radius; k++) {
+                    int d = abs(i) + abs(j) + abs(k);
+                    if (d == 0 || (N == NEIGHBORHOOD_VON_NEUMANN && d > Radius)) continue;
+                    this->m_offsets[c++] = (((i * this->m_py) + j) * this->m_pz) + k;
+                }
+            }
+        }
+
+        for (s = 0; s < States; s++) {
+            for (c = 0; c <= NEIGHBORS; c++) {
+                uint8_t next;
+                bool in_birth = c < 64 && ((Birth >> c) & 1);
+                bool in_survive = c < 64 && ((Survive >> c) & 1);
+
+                if (s == 0) next = in_birth ? 1 : 0;
+                else if (s == 1) next = in_survive ? 1 : (States > 2 ? 2 : 0);
+                else next = (s + 1 < States) ? s + 1 : 0;
+                this->m_rule[(s * (NEIGHBORS + 1)) + c] = next;
+            }
+        }
+    }
+
+    ~Automaton() {
+        delete[] this->m_current;
+        delete[] this->m_next;
+    }
+
+    void load(Grid *grid) override {
+        int i, j, k;
+
+        for (i = 0; i < this->x; i++) {
+            for (j = 0; j < this->y; j++) {
+                const uint8_t *src = grid->m_cells + grid->index(i, j, 0);
+                uint8_t *dst = this->m_current + index(i, j, 0);
+                for (k = 0; k < this->z; k++) {
+                    dst[k] = src[k] != 0;
+                }
+            }
+        }
+    }
+
+    void store(Grid *grid) override {
+        int i, j, k;
+
+        for (i = 0; i < this->x; i++) {
+            for (j = 0; j < this->y; j++) {
+                const uint8_t *src = this->m_current + index(i, j, 0);
+                uint8_t *dst = grid->m_cells + grid->index(i, j, 0);
+                for (k = 0; k < this->z; k++) {
+                    dst[k] = src[k] != 0;
+                }
+            }
+        }
+        grid->update_bricks();
+    }
+
+    void step() override {
+        const uint8_t *cur = this->m_current;
+        const uint8_t *rule = this->m_rule.data();
+        int i, j, k, n;
+
+        for (i = 0; i < this->x; i++) {
+            for (j = 0; j < this->y; j++) {
+                const size_t row = index(i, j, 0);
+
+                for (k = 0; k < this->z; k++) {
+                    const size_t c = row + k;
+                    int count = 0;
+
+                    for (n = 0; n < NEIGHBORS; n++) {
+                        count += alive(cur[c + this->m_offsets[n]]);
+                    }
+                    this->m_next[c] = rule[(cur[c] * (NEIGHBORS + 1)) + count];
+                }
+            }
+        }
+
+        uint8_t *temp = this->m_next;
+        this->m_next = this->m_current;
+        this->m_current = temp;
+    }
+
+    long population() override {
+        long count = 0;
+        int i, j, k;
+
+        for (i = 0; i < this->x; i++) {
+            for (j = 0; j < this->y; j++) {
+                const uint8_t *row = this->m_current + index(i, j, 0);
+                for (k = 0; k < this->z; k++) {
+                    count += alive(row[k]);
+                }
+            }
+        }
+        return count;
+    }
+};
+
+
+/**
+ *  A pre-instantiated rule, listed by automaton_rules().
+ */
+struct AutomatonRule {
+    const char *name;
+    const char *notation;
+    CellularAutomaton* (*create)(int x, int y, int z);
+};
+
+
+/**
+ *  Lists the rules compiled into the registry.
+ *
+ *  @param count    Set to the number of rules
+ *  @return Array of the rules
+ */
+const AutomatonRule* automaton_rules(int *count);
+
+/**
+ *  Creates an automaton for one of the registered rules.
+ *
+ *  @param name     Name of the rule, see automaton_rules()
+ *  @param x        Size of the x dimension
+ *  @param y        Size of the y dimension
+ *  @param z        Size of the z dimension
+ *  @return New automaton owned by the caller, nullptr for an unknown name
+ */
+CellularAutomaton* automaton_create(const char *name, int x, int y, int z);
+
+
+#endif
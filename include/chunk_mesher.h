@@ -0,0 +1,136 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef CHUNK_MESHER_H
+#define CHUNK_MESHER_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "mesh.h"
+#include "grid.h"
+#include "thread_pool.h"
+
+
+// Cells per edge of a chunk, must be a multiple of GRID_BRICK
+#define CHUNK_MESHER_SIZE   (16)
+
+
+/**
+ *  CPU side result of meshing one chunk, waiting to be uploaded.
+ */
+struct ChunkData {
+    int chunk;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+
+class ChunkMesher {
+private:
+    std::vector<Mesh*> m_meshes;
+    std::vector<uint8_t> m_dirty;
+    std::vector<ChunkData> m_pending;
+    int m_size;
+    int cx, cy, cz;
+
+    void release(int chunk);
+public:
+    int x, y, z;
+
+    /**
+     *  Constructs a ChunkMesher for grids of the given size. Every chunk
+     *  starts out dirty.
+     * 
+     *  @param x        Size of the x dimension of the grid
+     *  @param y        Size of the y dimension of the grid
+     *  @param z        Size of the z dimension of the grid
+     *  @param size     Cells per edge of a chunk
+     */
+    ChunkMesher(int x, int y, int z, int size = CHUNK_MESHER_SIZE);
+
+    /**
+     *  Deletes every chunk mesh.
+     */
+    ~ChunkMesher();
+
+    /**
+     *  Marks every chunk touching a changed brick as dirty. Cells reach one
+     *  sample past their corner, so the chunks before a brick are marked too.
+     * 
+     *  @param grid     Grid the brick indices refer to
+     *  @param bricks   Indices of the bricks that changed
+     */
+    void mark(Grid* grid, const std::vector<int>& bricks);
+
+    /**
+     *  Marks every chunk as dirty.
+     */
+    void mark_all();
+
+    /**
+     *  Meshes every dirty chunk on the CPU. Does not touch GL, so it may run
+     *  off the render thread.
+     * 
+     *  @param grid     Grid to mesh, must match the size given on construction
+     *  @param pool     Optional worker pool to mesh chunks in parallel
+     * 
+     *  @return Number of chunks meshed
+     */
+    int build(Grid* grid, ThreadPool* pool = nullptr);
+
+    /**
+     *  Uploads the chunks meshed by build() and replaces their old meshes.
+     * 
+     *  @return Number of chunks uploaded
+     */
+    int upload();
+
+    /**
+     *  Hands over the chunks meshed by build() without uploading them.
+     * 
+     *  @param out  Receives the pending chunks
+     */
+    void take(std::vector<ChunkData>& out);
+
+    /**
+     *  Uploads chunks meshed elsewhere.
+     * 
+     *  @param chunks   Chunks to upload, emptied on return
+     * 
+     *  @return Number of chunks uploaded
+     */
+    int upload(std::vector<ChunkData>& chunks);
+
+    /**
+     *  build() followed by upload().
+     * 
+     *  @return Number of chunks remeshed
+     */
+    int update(Grid* grid, ThreadPool* pool = nullptr);
+
+    /**
+     *  Renders every non-empty chunk. Shader is not bound in this function.
+     */
+    void render();
+
+    /**
+     *  @return Number of chunks, chunk indices are in [0:chunks)
+     */
+    int chunks() const;
+};
+
+
+#endif
@@ -18,8 +18,10 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <vector>
 
 #include "grid.h"
+#include "thread_pool.h"
 
 
 #define CONWAY_SURVIVE_LOW  (5)
@@ -27,13 +29,52 @@
 #define CONWAY_BIRTH_LOW    (6)
 #define CONWAY_BIRTH_HIGH   (6)
 
+// Longest cycle GameOfLife looks for
+#define CONWAY_PERIOD_MAX   (16)
+
+// Largest radius of step_boxsum(), its (2 * r + 1)^3 box counts are uint16_t
+#define CONWAY_RADIUS_MAX   (19)
+
 
 class GameOfLife {
 private:
+    /**
+     *  One step of a detected cycle, the bricks it changed and their new
+     *  cells in brick order.
+     */
+    struct CycleStep {
+        std::vector<int> bricks;
+        std::vector<uint8_t> cells;
+    };
+
     Grid *m_next;
+    std::vector<int> m_changed;
+    ThreadPool *m_pool;
+
+    std::vector<uint64_t> m_hashes;
+    std::vector<uint64_t> m_history;
+    std::vector<CycleStep> m_log;
+    uint64_t m_hash;
+    int m_age;
+    int m_period;
+    int m_candidate;
+    int m_phase;
 
     int count_neigbors(int x, int y, int z);
-    void wrap_bounds(int x0, int y0, int z0, int *x1, int *y1, int *z1);
+    void step_slab(int x0, int x1);
+    void step_brick(int b);
+    void sum_plane(int x, int radius, uint16_t *out, uint16_t *tmp);
+    void diff_bricks();
+    void diff_slab(int bx0, int bx1, std::vector<int>& changed_bricks);
+    bool diff_brick(int b);
+    void track();
+    void reset_cycle();
+    void log_step();
+    void apply_step(Grid *grid, const CycleStep &step);
+    void replay();
+    uint64_t hash_brick(int b);
+    static uint64_t mix_brick(int b, uint64_t h);
+    void brick_bounds(int b, int *lo, int *hi);
 public:
     Grid *m_current;
     int x;
@@ -41,13 +82,18 @@ public:
 	int z;
 
     /**
-     * Construct a new Game Of Life object
+     * Construct a new Game Of Life object. Sizes Grid::fits() rejects give
+     * an empty 0 x 0 x 0 automaton.
      * 
      * @param x_len     Length of the x dimension
      * @param y_len     Length of the y dimension
      * @param z_len     Length of the z dimension
+     * @param pool      Optional worker pool step() splits x-slabs across
+     * @param first_touch   Zero both grids from the workers of pool so each
+     *                      slab's pages are placed on the NUMA node of the
+     *                      thread that steps it
      */
-    GameOfLife(int x, int y, int z);
+    GameOfLife(int x, int y, int z, ThreadPool* pool = nullptr, bool first_touch = false);
     
     /**
      * Destroy the Game Of Life object
@@ -62,12 +108,112 @@ public:
     void populate(int percent);
 
     /**
-     *  Applies the given rule represented by:
-     *      [A A A A B B B B C C C C D D D D]
-     *      - Live cells remain living if they have between A and B neighbors
-     *      - Dead cells become alive  if they have between C and D neighnors
+     *  Cells outside the grid count as dead.
+     * 
+     *  Applies the rule given by the CONWAY_* ranges:
+     *      - Live cells remain living if they have between SURVIVE_LOW and
+     *        SURVIVE_HIGH neighbors
+     *      - Dead cells become alive  if they have between BIRTH_LOW and
+     *        BIRTH_HIGH neighbors
+     * 
+     *  Other rules are available through Automaton (automaton.h).
+     */
+    void step();
+
+    /**
+     *  Same as step() but counts neighbors with three separable running sums
+     *  (z, then y, then x) over a ring of 2 * radius + 1 planes, so the cost
+     *  per cell does not depend on the radius. The count of every cell in the
+     *  (2 * radius + 1)^3 box around it, minus itself, is tested against the
+     *  CONWAY_* ranges.
+     * 
+     *  The ranges are fixed and sized for the 26 neighbors of radius 1, so a
+     *  larger radius still tests its counts against them. Until the ranges
+     *  can be set, larger radii exercise the counting and not a rule worth
+     *  running.
+     * 
+     *  @param radius   Radius of the neighborhood in [1:CONWAY_RADIUS_MAX],
+     *                  1 gives the usual 26 neighbors
+     * 
+     *  @return CODE_SUCCESS, or CODE_INDEX_OUT_OF_BOUNDS without stepping if
+     *          the radius is out of range.
+     */
+    int step_boxsum(int radius = 1);
+
+    /**
+     *  Same result as step() but only evaluates the bricks that changed in
+     *  the last generation and their neighbors, so the cost follows the
+     *  activity rather than the volume. Every other brick is known to stay
+     *  as it is. Cells written into m_current directly are not seen, call
+     *  populate() or step() after editing the grid by hand.
+     */
+    void step_active();
+
+    /**
+     *  Lists the bricks (see Grid::brick()) holding at least one cell that
+     *  changed in the last step, or every brick after populate().
+     * 
+     *  @return Brick indices of m_current in ascending order
+     */
+    const std::vector<int>& changed() const;
+
+    /**
+     *  Every step hashes the bricks it changed and compares the state with
+     *  the last CONWAY_PERIOD_MAX generations. Once a repeat has held for
+     *  a whole period the steps stop evaluating cells and replay the
+     *  logged changes of each phase instead, changed() still reports them.
+     *  populate() starts the search over.
+     * 
+     *  @return Period of the cycle the automaton settled in, 1 for a still
+     *          life, or 0 while none has been found
+     */
+    int period() const;
+};
+
+
+/**
+ *  Same automaton as GameOfLife with both generations stored in bit packed
+ *  grids, 8x less memory and bandwidth per generation. Cells outside the
+ *  grid count as dead.
+ */
+class BitLife {
+private:
+    BitGrid *m_next;
+
+    static void add2(uint64_t *t, uint64_t s0, uint64_t s1);
+    static uint64_t equals(const uint64_t *t, int k);
+public:
+    BitGrid *m_current;
+    int x;
+	int y;
+	int z;
+
+    /**
+     * Construct a new BitLife object
+     * 
+     * @param x_len     Length of the x dimension
+     * @param y_len     Length of the y dimension
+     * @param z_len     Length of the z dimension
+     */
+    BitLife(int x, int y, int z);
+
+    /**
+     * Destroy the BitLife object
+     */
+    ~BitLife();
+
+    /**
+     *  Populates the grid with living cells. Draws the same random numbers
+     *  in the same order as GameOfLife::populate.
      * 
-     *  @param rule     Rule for the system
+     *  @param percent   Percent of the cells to fill in the range [0:100]  
+     */
+    void populate(int percent);
+
+    /**
+     *  Advances the automaton by one generation using the CONWAY_* rule.
+     *  Bit-sliced: 64 cells are counted at once with a network of full
+     *  adders over the packed rows and the rule is applied as boolean logic.
      */
     void step();
 };
@@ -0,0 +1,90 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define CPU_X86 1
+    #include <immintrin.h>
+#else
+    #define CPU_X86 0
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+    #define CPU_TARGET_AVX2
+    #define CPU_TARGET_SSE41
+#else
+    #define CPU_TARGET_AVX2 __attribute__((target("avx2")))
+    #define CPU_TARGET_SSE41 __attribute__((target("sse4.1")))
+#endif
+
+#if CPU_X86 && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #define CPU_SSE2 1
+#else
+    #define CPU_SSE2 0
+#endif
+
+
+/**
+ *  Runtime instruction set checks, safe to call on any architecture.
+ * 
+ *  @return true if the running CPU supports the instruction set
+ */
+bool cpu_has_sse2();
+bool cpu_has_sse41();
+bool cpu_has_avx2();
+
+/**
+ *  @return Index of the lowest set bit, v must not be 0
+ */
+static inline int cpu_ctz(uint32_t v) {
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward(&i, v);
+    return (int) i;
+#else
+    return __builtin_ctz(v);
+#endif
+}
+
+/**
+ *  @return Index of the lowest set bit, v must not be 0
+ */
+static inline int cpu_ctz64(uint64_t v) {
+#if defined(_MSC_VER)
+    uint32_t lo = (uint32_t) v;
+    return lo ? cpu_ctz(lo) : 32 + cpu_ctz((uint32_t) (v >> 32));
+#else
+    return __builtin_ctzll(v);
+#endif
+}
+
+/**
+ *  @return Number of set bits
+ */
+static inline int cpu_popcount(uint64_t v) {
+#if defined(_MSC_VER)
+    return (int) __popcnt64(v);
+#else
+    return __builtin_popcountll(v);
+#endif
+}
+
+
+#endif
@@ -0,0 +1,110 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef GPU_LIFE_H
+#define GPU_LIFE_H
+
+#include <stdint.h>
+
+#include <shader.h>
+
+#include "grid.h"
+
+
+// Invocations per work group, must match local_size_x in life.comp
+#define GPU_LIFE_GROUP      (64)
+
+// Work groups per dispatch dimension every GL 4.3 implementation supports
+#define GPU_LIFE_MAX_GROUPS (65535)
+
+
+/**
+ *  The GameOfLife automaton stepped by a compute shader. Both generations
+ *  stay on the GPU in shader storage buffers, bit packed the same way as
+ *  BitGrid, and trade places after every pass. Cells only come back to
+ *  the CPU through store().
+ *
+ *  Needs a current GL 4.3 context for everything but the constructor.
+ */
+class GpuLife {
+private:
+    Shader m_shader;
+    GLuint m_buffers[2];
+    int m_current;
+    int m_words;
+    size_t m_bytes;
+public:
+    int x;
+    int y;
+    int z;
+
+    /**
+     *  Constructs a GpuLife object, init() must be called before use.
+     *
+     *  @param x    Size of the x dimension
+     *  @param y    Size of the y dimension
+     *  @param z    Size of the z dimension
+     */
+    GpuLife(int x, int y, int z);
+
+    /**
+     *  Deletes the buffers.
+     */
+    ~GpuLife();
+
+    /**
+     *  Compiles life.comp and allocates both generations with every cell
+     *  dead.
+     *
+     *  @return CODE_SUCCESS if success, else a relevant error code.
+     */
+    int init();
+
+    /**
+     *  Uploads the cells of a grid of the same size into the current
+     *  generation.
+     */
+    void load(BitGrid *grid);
+    void load(Grid *grid);
+
+    /**
+     *  Reads the current generation back into a grid of the same size.
+     *  Waits for every pending step() to finish.
+     */
+    void store(BitGrid *grid);
+    void store(Grid *grid);
+
+    /**
+     *  Queues one compute pass per generation using the CONWAY_* rule.
+     *  Returns without waiting for the GPU.
+     *
+     *  @param generations  Number of generations to advance
+     */
+    void step(int generations = 1);
+
+    /**
+     *  @return The shader storage buffer holding the current generation,
+     *          32 cells per uint, ((x * y_len) + y) * words + w
+     */
+    GLuint buffer() const;
+
+    /**
+     *  @return Number of uints per row of buffer()
+     */
+    int words() const;
+};
+
+
+#endif
@@ -0,0 +1,148 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef GPU_MCUBES_H
+#define GPU_MCUBES_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <mesh.h>
+#include <shader.h>
+
+#include "gpu_life.h"
+#include "grid.h"
+
+
+// Invocations per work group, must match local_size_x in mcubes.comp
+#define GPU_MC_GROUP        (64)
+
+// Values per work group of scan.comp, two per invocation
+#define GPU_MC_SCAN_BLOCK   (512)
+
+// Most triangles the vertex buffer can hold, mcubes.comp indexes the floats
+// of the buffer with a uint, three vertices of eight floats per triangle
+#define GPU_MC_CAPACITY_MAX (UINT32_MAX / (3 * 8))
+
+
+/**
+ *  Marching cubes in compute shaders. The cells sit on the GPU as a 3D
+ *  texture, or are read straight from a GpuLife. One pass counts the
+ *  triangles of every cell, a prefix sum turns the counts into where each
+ *  cell writes, and a second pass writes the triangles into a vertex buffer
+ *  along with the glDrawArraysIndirect command that draws them. Nothing
+ *  comes back to the CPU, so a volume that changes every frame can be
+ *  remeshed every frame.
+ *
+ *  The mesh is the same triangle list MarchingCubeGenerator::generate()
+ *  builds, cut short at the capacity given to the constructor.
+ *
+ *  Needs a current GL 4.3 context for everything but the constructor.
+ */
+class GpuMarchingCubes {
+private:
+    Shader m_mesher;
+    Shader m_scan;
+    GLuint m_volume;
+    GLuint m_tables;
+    GLuint m_triangles;
+    GLuint m_vertices;
+    GLuint m_command;
+    GLuint m_vao;
+    std::vector<GLuint> m_sums;
+    int64_t m_cells;
+    int64_t m_capacity;
+
+    void run(int source, GLuint bits, int words);
+    void scan(GLuint data, int64_t n, int level);
+public:
+    int x;
+    int y;
+    int z;
+
+    /**
+     *  Constructs a GpuMarchingCubes object, init() must be called before
+     *  use.
+     *
+     *  @param x            Size of the x dimension
+     *  @param y            Size of the y dimension
+     *  @param z            Size of the z dimension
+     *  @param capacity     Most triangles the vertex buffer holds, the rest
+     *                      are dropped. Clamped to [0:GPU_MC_CAPACITY_MAX].
+     */
+    GpuMarchingCubes(int x, int y, int z, int64_t capacity);
+
+    /**
+     *  Deletes the texture and buffers.
+     */
+    ~GpuMarchingCubes();
+
+    /**
+     *  Compiles mcubes.comp and scan.comp and allocates the volume, the
+     *  vertex buffer and the scratch space of the prefix sum.
+     *
+     *  @return CODE_SUCCESS if success, else a relevant error code.
+     */
+    int init();
+
+    /**
+     *  Uploads the cells of a grid of the same size into the volume texture.
+     */
+    void load(Grid *grid);
+
+    /**
+     *  Queues the passes meshing the volume texture. Returns without
+     *  waiting for the GPU.
+     */
+    void generate();
+
+    /**
+     *  Queues the passes meshing the current generation of a GpuLife of the
+     *  same size, read in place from its buffer.
+     */
+    void generate(GpuLife *life);
+
+    /**
+     *  Draws the last mesh generated with whatever shader is bound.
+     */
+    void render();
+
+    /**
+     *  Reads the triangle count back. Waits for the GPU, meant for tests
+     *  and tools.
+     *
+     *  @return Triangles in the last mesh before the capacity cut them short
+     */
+    int64_t triangles();
+
+    /**
+     *  Reads the vertices of the last mesh back, three per triangle. Waits
+     *  for the GPU, meant for tests and tools.
+     */
+    void store(std::vector<Vertex> &vertices);
+
+    /**
+     *  @return The vertex buffer, laid out as Vertex
+     */
+    GLuint buffer() const;
+
+    /**
+     *  @return Most triangles the vertex buffer holds, after clamping
+     */
+    int64_t capacity() const;
+};
+
+
+#endif
@@ -16,17 +16,33 @@
 #ifndef GRID_H
 #define GRID_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 
+// Cells per edge of a brick, the unit Grid summarizes occupancy in
+#define GRID_BRICK_SHIFT    (3)
+#define GRID_BRICK          (1 << GRID_BRICK_SHIFT)
+
+// Brick count that has not been computed yet
+#define GRID_BRICK_UNKNOWN  (0xFFFF)
+
+
+enum BrickState {
+    BRICK_EMPTY, BRICK_FULL, BRICK_MIXED
+};
 
 
 struct Grid {
     uint8_t *m_cells;
+    uint16_t *m_bricks;
+    bool m_owned;
     int x, y, z;
+    int bx, by, bz;
 
     /**
-     *  Constructs a new Grid struct
+     *  Constructs a new Grid struct. Sizes fits() rejects give an empty
+     *  0 x 0 x 0 grid instead.
      * 
      *  @param x   Size of the x dimension
      *  @param y   Size of the y dimension
@@ -34,6 +50,26 @@ struct Grid {
      */
     Grid(int x, int y, int z);
 
+    /**
+     *  Constructs a Grid over cells stored elsewhere, e.g. a memory mapped
+     *  file. The cells are not copied or freed and must outlive the Grid.
+     * 
+     *  @param x       Size of the x dimension
+     *  @param y       Size of the y dimension
+     *  @param z       Size of the z dimension
+     *  @param cells   x * y * z cells laid out like m_cells
+     */
+    Grid(int x, int y, int z, uint8_t *cells);
+
+    /**
+     *  Whether a grid of the given size can be indexed: the cells of the
+     *  whole grid must fit in a size_t, and those of an x plane and the
+     *  bricks in an int.
+     * 
+     *  @return true if Grid and DensityGrid can hold x * y * z cells
+     */
+    static bool fits(int x, int y, int z);
+
     /**
      *  Destroys a Grid struct
      */
@@ -42,7 +78,145 @@ struct Grid {
 	/**
 	 * Converts the xyz indicies to a single index
 	 */
-	int index(int x, int y, int z);
+	size_t index(int x, int y, int z);
+
+    /**
+     *  Sets a cell and keeps the occupancy of its brick up to date. Code
+     *  writing m_cells directly must call update_bricks() afterwards.
+     * 
+     *  @param x    x coordinate of the cell
+     *  @param y    y coordinate of the cell
+     *  @param z    z coordinate of the cell
+     *  @param v    New value of the cell, non-zero is solid
+     */
+    void set(int x, int y, int z, uint8_t v);
+
+    /**
+     *  Recounts the solid cells of every brick.
+     */
+    void update_bricks();
+
+    /**
+     *  Recounts the solid cells of a single brick.
+     * 
+     *  @param b    Brick index, see brick()
+     */
+    void update_brick(int b);
+
+    /**
+     *  @return Index of the brick holding the cell at x, y, z
+     */
+    int brick(int x, int y, int z);
+
+    /**
+     *  @return Whether brick b is all empty, all solid or a mix of both.
+     *          Bricks that were never counted are reported as mixed.
+     */
+    BrickState brick_state(int b);
+
+    /**
+     *  Combines the state of every brick overlapping the cells in
+     *  [x0:x1) x [y0:y1) x [z0:z1). Conservative, a region made of bricks that
+     *  are only partly inside it is reported from the whole bricks.
+     * 
+     *  @return BRICK_EMPTY or BRICK_FULL if all those bricks agree, else BRICK_MIXED
+     */
+    BrickState region_state(int x0, int y0, int z0, int x1, int y1, int z1);
+
+    /**
+     *  @return Number of solid cells, from the brick summary where possible
+     */
+    long count();
+};
+
+
+struct DensityGrid {
+    float *m_values;
+    int x, y, z;
+
+    /**
+     *  Constructs a new DensityGrid struct. Samples are laid out the same way
+     *  as the cells of a Grid, and sizes Grid::fits() rejects give an empty
+     *  0 x 0 x 0 grid.
+     * 
+     *  @param x   Size of the x dimension
+     *  @param y   Size of the y dimension
+     *  @param z   Size of the z dimension
+     */
+    DensityGrid(int x, int y, int z);
+
+    /**
+     *  Destroys a DensityGrid struct
+     */
+    ~DensityGrid();
+
+	/**
+	 * Converts the xyz indicies to a single index
+	 */
+	size_t index(int x, int y, int z);
+};
+
+
+/**
+ *  Grid of boolean cells packed 1 bit per cell. Every row along z starts on a
+ *  fresh 64 bit word, bit i of word w holds the cell at z = 64w + i. Bits past
+ *  the end of a row are always 0.
+ */
+struct BitGrid {
+    uint64_t *m_words;
+    int x, y, z;
+    int words;
+
+    /**
+     *  Constructs a new BitGrid struct with every cell cleared.
+     * 
+     *  @param x   Size of the x dimension
+     *  @param y   Size of the y dimension
+     *  @param z   Size of the z dimension
+     */
+    BitGrid(int x, int y, int z);
+
+    /**
+     *  Destroys a BitGrid struct
+     */
+    ~BitGrid();
+
+    /**
+     *  @return Pointer to the first word of the row at x, y
+     */
+    uint64_t* row(int x, int y);
+
+    /**
+     *  Reads or writes a single cell.
+     */
+    bool get(int x, int y, int z);
+    void set(int x, int y, int z, bool v);
+
+    /**
+     *  @return Mask of the valid bits in word w of a row
+     */
+    uint64_t mask(int w);
+
+    /**
+     *  @return Number of live cells in the row at x, y
+     */
+    long count_row(int x, int y);
+
+    /**
+     *  @return Number of live cells in the grid
+     */
+    long count();
+
+    /**
+     *  Copies a Grid of the same size in, any non-zero cell is set.
+     */
+    void pack(Grid* grid);
+
+    /**
+     *  Copies the cells out into a Grid of the same size as 0 or 1 and
+     *  refreshes its brick summary.
+     */
+    void unpack(Grid* grid);
 };
 
 
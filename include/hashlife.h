@@ -0,0 +1,138 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef HASHLIFE_H
+#define HASHLIFE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_set>
+#include <vector>
+
+#include "grid.h"
+
+
+// Canonical nodes kept before advance() collects the unreachable ones
+#define HASHLIFE_NODE_LIMIT (1 << 22)
+
+
+/**
+ *  A cube of 2^level cells. Level 0 nodes are single cells, every other
+ *  level is split into 8 octants indexed (x << 2) | (y << 1) | z.
+ */
+struct HashNode {
+    HashNode *child[8];
+    HashNode *result;
+    uint64_t population;
+    int level;
+    int result_step;
+    bool marked;
+};
+
+
+/**
+ *  The GameOfLife automaton on an unbounded grid, stored as a hash-consed
+ *  octree. Equal cubes share one node, and each node remembers its centre
+ *  some generations ahead. Regular or repeating patterns can then advance
+ *  exponentially many generations per step.
+ *
+ *  Unlike GameOfLife, nothing clips the pattern at the faces of a Grid, so
+ *  both only agree while the pattern stays away from those faces.
+ */
+class HashLife {
+private:
+    struct NodeHash {
+        size_t operator()(const HashNode *n) const;
+    };
+    struct NodeEqual {
+        bool operator()(const HashNode *a, const HashNode *b) const;
+    };
+
+    std::unordered_set<HashNode*, NodeHash, NodeEqual> m_nodes;
+    std::vector<HashNode*> m_empty;
+    HashNode m_dead;
+    HashNode m_alive;
+    HashNode *m_root;
+    int64_t m_ox, m_oy, m_oz;
+    uint64_t m_generation;
+
+    HashNode* join(HashNode **child);
+    HashNode* empty(int level);
+    HashNode* grandchild(HashNode *n, int x, int y, int z);
+    HashNode* centre(HashNode *n);
+    HashNode* expand(HashNode *n);
+    HashNode* result(HashNode *n, int step);
+    HashNode* base(HashNode *n);
+    HashNode* build(Grid *grid, int level, int x, int y, int z);
+    void write(HashNode *n, Grid *grid, int64_t x, int64_t y, int64_t z);
+    void step(int step);
+    void mark(HashNode *n);
+    void collect();
+public:
+    /**
+     *  Constructs an empty universe.
+     */
+    HashLife();
+
+    /**
+     *  Frees every node.
+     */
+    ~HashLife();
+
+    /**
+     *  Replaces the universe with the cells of a grid, cell (x, y, z) of the
+     *  grid lands on (x, y, z) of the universe. Resets generation() to 0.
+     *
+     *  @param grid     Grid to copy, its brick counts must be up to date
+     */
+    void load(Grid *grid);
+
+    /**
+     *  Copies the cube of the universe starting at (x0, y0, z0) into a grid
+     *  and recounts its bricks.
+     *
+     *  @param grid     Grid to fill, its size is the size of the window
+     *  @param x0       x coordinate of the universe at grid cell 0
+     *  @param y0       y coordinate of the universe at grid cell 0
+     *  @param z0       z coordinate of the universe at grid cell 0
+     */
+    void store(Grid *grid, int64_t x0 = 0, int64_t y0 = 0, int64_t z0 = 0);
+
+    /**
+     *  Advances the universe by any number of generations, one power of
+     *  two at a time.
+     *
+     *  @param generations  Number of generations to advance
+     */
+    void advance(uint64_t generations);
+
+    /**
+     *  @return Generations advanced since load()
+     */
+    uint64_t generation() const;
+
+    /**
+     *  @return Number of living cells
+     */
+    uint64_t population() const;
+
+    /**
+     *  @return Number of canonical nodes currently stored
+     */
+    size_t nodes() const;
+};
+
+
+#endif
@@ -0,0 +1,113 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef LIFE_WORKER_H
+#define LIFE_WORKER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "chunk_mesher.h"
+#include "conway.h"
+#include "thread_pool.h"
+
+
+/**
+ *  Chunks remeshed for one generation, handed from the worker to the
+ *  render thread.
+ */
+struct LifeFrame {
+    uint64_t generation;
+    std::vector<ChunkData> chunks;
+};
+
+
+/**
+ *  Steps a GameOfLife and remeshes the chunks it changed on a background
+ *  thread. Finished meshes wait in a single slot mailbox swapped with
+ *  atomic exchanges, so the render thread never blocks on the simulation
+ *  and only uploads.
+ *
+ *  Once the worker is running it owns the GameOfLife, nothing else may
+ *  touch it until the worker is destroyed.
+ */
+class LifeWorker {
+private:
+    GameOfLife *m_life;
+    ThreadPool *m_pool;
+    ChunkMesher m_mesher;
+    std::atomic<LifeFrame*> m_mailbox;
+    std::atomic<uint64_t> m_shown;
+    std::atomic<int> m_period;
+    std::vector<std::vector<ChunkData>> m_cycle;
+    uint64_t m_cycle_start;
+
+    std::thread m_thread;
+    std::mutex m_lock;
+    std::condition_variable m_wake;
+    uint64_t m_requested;
+    bool m_stop;
+
+    void run();
+    void publish(LifeFrame *frame);
+public:
+    /**
+     *  Starts the worker, which meshes the whole grid right away.
+     *
+     *  @param life     Automaton to step, not owned
+     *  @param pool     Optional pool to step and mesh with. Used from the
+     *                  worker thread only, so it must not be shared with
+     *                  the render thread.
+     */
+    LifeWorker(GameOfLife *life, ThreadPool *pool = nullptr);
+
+    /**
+     *  Finishes the generation in flight and joins the worker.
+     */
+    ~LifeWorker();
+
+    /**
+     *  Asks for more generations without waiting for them.
+     *
+     *  @param generations  Number of generations to add to the queue
+     */
+    void request(int generations = 1);
+
+    /**
+     *  Uploads the latest finished meshes, if any. Call from the GL thread.
+     *
+     *  @param mesher   Mesher owning the chunk meshes that are rendered
+     *
+     *  @return Number of chunks uploaded
+     */
+    int poll(ChunkMesher *mesher);
+
+    /**
+     *  @return Generation of the last meshes uploaded by poll()
+     */
+    uint64_t generation() const;
+
+    /**
+     *  @return GameOfLife::period() as of the last generation stepped
+     */
+    int period() const;
+};
+
+
+#endif
@@ -0,0 +1,125 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef MAPPED_GRID_H
+#define MAPPED_GRID_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "grid.h"
+
+
+/**
+ *  How the cells of a volume file are ordered. Neither layout has a header,
+ *  the size of the volume is given when it is opened.
+ *
+ *  GRID_RAW        One byte per cell in the order of Grid::m_cells.
+ *  GRID_BRICKED    GRID_BRICK^3 cell bricks in the order of Grid::brick(),
+ *                  the cells of a brick in the order of Grid::m_cells. Bricks
+ *                  on the far faces are padded out to full size.
+ */
+enum GridLayout {
+    GRID_RAW, GRID_BRICKED
+};
+
+
+/**
+ *  A volume of Grid cells memory mapped from a file instead of read into the
+ *  heap, so volumes far larger than RAM can be walked through. Pages are
+ *  read on first touch and can be handed back with release(). The mapping
+ *  is copy-on-write, writes through a slab never reach the file.
+ */
+class MappedGrid {
+private:
+    uint8_t *m_data;
+    size_t m_bytes;
+#ifdef _WIN32
+    void *m_file;
+    void *m_mapping;
+#else
+    int m_file;
+#endif
+public:
+    int x, y, z;
+    GridLayout layout;
+
+    /**
+     *  Constructs a MappedGrid with nothing mapped, open() must be called
+     *  before use.
+     */
+    MappedGrid();
+
+    /**
+     *  Unmaps the volume.
+     */
+    ~MappedGrid();
+
+    /**
+     *  Maps a volume file.
+     *
+     *  @param path     Path of the volume file
+     *  @param x        Size of the x dimension
+     *  @param y        Size of the y dimension
+     *  @param z        Size of the z dimension
+     *  @param layout   Order of the cells in the file
+     *
+     *  @return CODE_SUCCESS if success, CODE_INVALID_FILENAME if the file
+     *          cannot be opened or CODE_READING_ERROR if it is too small or
+     *          cannot be mapped.
+     */
+    int open(const char *path, int x, int y, int z, GridLayout layout = GRID_RAW);
+
+    /**
+     *  Unmaps the volume, if any.
+     */
+    void close();
+
+    /**
+     *  @return Size of the volume file in bytes
+     */
+    size_t bytes() const;
+
+    /**
+     *  @return The cell at x, y, z
+     */
+    uint8_t get(int x, int y, int z) const;
+
+    /**
+     *  Makes a Grid of the x-planes in [x0:x1) with an up to date brick
+     *  summary. A raw volume is viewed in place, a bricked one is copied
+     *  out.
+     *
+     *  @return A newly allocated Grid of x1 - x0 planes
+     */
+    Grid *slab(int x0, int x1);
+
+    /**
+     *  Hands the pages of the x-planes in [x0:x1) back to the OS. They are
+     *  read in again if touched later.
+     */
+    void release(int x0, int x1);
+
+    /**
+     *  Writes a Grid to a volume file.
+     *
+     *  @return CODE_SUCCESS if success, CODE_INVALID_FILENAME if the file
+     *          cannot be created or CODE_READING_ERROR if writing fails.
+     */
+    static int write(const char *path, Grid *grid, GridLayout layout = GRID_RAW);
+};
+
+
+#endif
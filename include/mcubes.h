@@ -17,11 +17,78 @@
 #ifndef MARCHING_CUBES_H
 #define MARCHING_CUBES_H
 
+#include <stdint.h>
+#include <functional>
+#include <vector>
+
 #include "mesh.h"
 #include "grid.h"
+#include "mapped_grid.h"
+#include "thread_pool.h"
+
+
+// "DMSH", first word of a mesh file written by generate_file()
+#define MC_FILE_MAGIC   (0x48534D44)
+
+// Planes of cells read in at a time by generate_file()
+#define MC_FILE_SLAB    (64)
+
+// Faces of a chunk in the transition mask of generate_lod(), bit
+// (2 * axis) + side
+#define MC_LOD_NEG_X    (1 << 0)
+#define MC_LOD_POS_X    (1 << 1)
+#define MC_LOD_NEG_Y    (1 << 2)
+#define MC_LOD_POS_Y    (1 << 3)
+#define MC_LOD_NEG_Z    (1 << 4)
+#define MC_LOD_POS_Z    (1 << 5)
+
+
+/**
+ *  Start of a mesh file. The vertices follow as Vertex structs, then the
+ *  indices as uint32_t, three per face, all in the byte order of the writer.
+ */
+struct MeshFileHeader {
+    uint32_t magic;
+    uint32_t vertex_size;   // sizeof(Vertex)
+    uint64_t vertices;
+    uint64_t indices;
+};
+
+
+/**
+ *  What a generate_file() run did and how fast.
+ */
+struct MeshFileStats {
+    double seconds;
+    double megabytes;       // Of volume meshed
+    double mb_per_second;
+    uint64_t vertices;
+    uint64_t indices;
+};
+
+
+/**
+ *  Gradient of the field a DensityGrid was sampled from, at a point in the
+ *  sample coordinates of the grid.
+ */
+typedef std::function<void(const vec3 position, vec3 gradient)> DensityGradient;
+
+/**
+ *  Writes the density samples of plane x to slice[(y * size_z) + z].
+ */
+typedef std::function<void(int x, float* slice)> DensitySlice;
+
+/**
+ *  Fills grid with the density samples of lattice points
+ *  (x + stride * i, y + stride * j, z + stride * k). A lattice point has to
+ *  get the same value whatever stride it is sampled with.
+ */
+typedef std::function<void(int x, int y, int z, int stride, DensityGrid* grid)> DensityBox;
 
 
 class MarchingCubeGenerator {
+private:
+    static void generate_slab(Grid* grid, int x0, int x1, std::vector<Vertex>& vertices);
 public:
     /**
      *  Uses the marching cube algorithm to convert a three-dimensional array
@@ -32,6 +99,243 @@ public:
      *  @return A newly allocated mesh object generated from marching cubes.
      */
     static Mesh* generate(Grid* cells);
+
+    /**
+     *  Same as generate(Grid*) but splits the grid into x-slabs that are
+     *  meshed on a worker pool. The output is identical to the single
+     *  threaded version.
+     * 
+     *  @params cells   A Grid object defining a three-dimensional array of cells.
+     *  @params pool    Worker pool to mesh the slabs on.
+     * 
+     *  @return A newly allocated mesh object generated from marching cubes.
+     */
+    static Mesh* generate(Grid* cells, ThreadPool* pool);
+
+    /**
+     *  Runs marching cubes without uploading anything to the GPU.
+     * 
+     *  @params cells       A Grid object defining a three-dimensional array of cells.
+     *  @params vertices    Receives the triangle list, three vertices per face.
+     *  @params pool        Optional worker pool, nullptr meshes on the calling thread.
+     */
+    static void generate(Grid* cells, std::vector<Vertex>& vertices, ThreadPool* pool = nullptr);
+
+    /**
+     *  Uses marching cubes to build an indexed mesh. Every edge crossing is
+     *  emitted exactly once and shared by all triangles touching it, normals
+     *  are the average of the surrounding face normals.
+     * 
+     *  @params cells   A Grid object defining a three-dimensional array of cells.
+     * 
+     *  @return A newly allocated, indexed mesh object.
+     */
+    static Mesh* generate_indexed(Grid* cells);
+
+    /**
+     *  Runs indexed marching cubes without uploading anything to the GPU.
+     * 
+     *  @params cells       A Grid object defining a three-dimensional array of cells.
+     *  @params vertices    Receives the welded vertices.
+     *  @params indices     Receives three indices per face.
+     */
+    static void generate_indexed(Grid* cells, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+    /**
+     *  Runs indexed marching cubes over the cells in [x0:x1) x [y0:y1) x [z0:z1)
+     *  only. A cell at x spans the samples x and x + 1, so x1 may be at most
+     *  cells->x - 1. Vertices stay in the coordinates of the whole grid, and
+     *  normals on the border of the region take in the faces of the cells
+     *  just outside it, so they match the mesh of the whole grid.
+     * 
+     *  @params cells       A Grid object defining a three-dimensional array of cells.
+     *  @params vertices    Receives the welded vertices.
+     *  @params indices     Receives three indices per face.
+     */
+    static void generate_indexed(Grid* cells, int x0, int y0, int z0, int x1, int y1, int z1,
+                                 std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+    /**
+     *  Indexed marching cubes straight from a bit packed grid.
+     * 
+     *  @params cells   A BitGrid object defining a three-dimensional array of cells.
+     * 
+     *  @return A newly allocated, indexed mesh object.
+     */
+    static Mesh* generate_indexed(BitGrid* cells);
+
+    /**
+     *  Runs bit packed marching cubes without uploading anything to the GPU.
+     * 
+     *  @params cells       A BitGrid object defining a three-dimensional array of cells.
+     *  @params vertices    Receives the welded vertices.
+     *  @params indices     Receives three indices per face.
+     */
+    static void generate_indexed(BitGrid* cells, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+    /**
+     *  Uses marching cubes to extract the iso surface of a density field.
+     *  Vertices are interpolated to where the density crosses the iso value
+     *  and normals are taken from the density gradient. Samples below the
+     *  iso value are solid.
+     * 
+     *  @params grid    A DensityGrid of samples.
+     *  @params iso     Iso value of the surface.
+     * 
+     *  @return A newly allocated, indexed mesh object.
+     */
+    static Mesh* generate(DensityGrid* grid, float iso);
+
+    /**
+     *  Runs density marching cubes without uploading anything to the GPU.
+     *  With a pool the grid is meshed in x-slabs on the workers. The
+     *  triangles and normals are the same, but vertices on the planes
+     *  between slabs are repeated once per slab.
+     * 
+     *  @params grid        A DensityGrid of samples.
+     *  @params iso         Iso value of the surface.
+     *  @params vertices    Receives the welded vertices.
+     *  @params indices     Receives three indices per face.
+     *  @params pool        Optional worker pool, nullptr meshes on the calling thread.
+     */
+    static void generate(DensityGrid* grid, float iso, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                         ThreadPool* pool = nullptr);
+
+    /**
+     *  Density marching cubes with every normal taken straight from the
+     *  gradient of the underlying field at the vertex, e.g. an analytic
+     *  noise derivative, instead of central differences of the samples.
+     * 
+     *  @params grid        A DensityGrid of samples.
+     *  @params iso         Iso value of the surface.
+     *  @params gradient    Gradient of the field the grid was sampled from.
+     * 
+     *  @return A newly allocated, indexed mesh object.
+     */
+    static Mesh* generate(DensityGrid* grid, float iso, const DensityGradient& gradient);
+
+    /**
+     *  Runs density marching cubes with field normals without uploading
+     *  anything to the GPU.
+     * 
+     *  @params grid        A DensityGrid of samples.
+     *  @params iso         Iso value of the surface.
+     *  @params gradient    Gradient of the field the grid was sampled from.
+     *  @params vertices    Receives the welded vertices.
+     *  @params indices     Receives three indices per face.
+     */
+    static void generate(DensityGrid* grid, float iso, const DensityGradient& gradient,
+                         std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+    /**
+     *  Density marching cubes over a field that is never held in memory as
+     *  a whole. Sample planes are asked for in order of x into a two plane
+     *  ring and dropped once the cells between them are meshed, so memory
+     *  is O(y * z) plus the mesh. The mesh is the same generate() gives for
+     *  a DensityGrid holding every plane.
+     *
+     *  @params x           Number of sample planes along x.
+     *  @params y           Samples per plane along y.
+     *  @params z           Samples per plane along z.
+     *  @params iso         Iso value of the surface.
+     *  @params slice       Fills in one plane, called once for each plane.
+     *  @params gradient    Gradient of the field, there are no neighbouring
+     *                      planes to take central differences from.
+     *
+     *  @return A newly allocated, indexed mesh object.
+     */
+    static Mesh* generate_streamed(int x, int y, int z, float iso, const DensitySlice& slice,
+                                   const DensityGradient& gradient);
+
+    /**
+     *  Runs streamed density marching cubes without uploading anything to
+     *  the GPU.
+     *
+     *  @params vertices    Receives the welded vertices.
+     *  @params indices     Receives three indices per face.
+     */
+    static void generate_streamed(int x, int y, int z, float iso, const DensitySlice& slice,
+                                  const DensityGradient& gradient,
+                                  std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+    /**
+     *  Density marching cubes over one chunk of a multi-resolution terrain.
+     *  The chunk spans size cells of stride lattice steps along each axis
+     *  from lattice point (x, y, z), and vertices are in lattice steps, so
+     *  chunks of any stride line up. Faces in transitions border chunks of
+     *  half the stride. Those faces get a transition cell in every cell that
+     *  joins the coarse contour of the chunk to the fine contour of the
+     *  neighbour, so the seam has no cracks. A chunk and its neighbours
+     *  compute shared vertices bit for bit the same.
+     *
+     *  @params x           Lattice x of the first corner, a multiple of stride.
+     *  @params y           Lattice y of the first corner, a multiple of stride.
+     *  @params z           Lattice z of the first corner, a multiple of stride.
+     *  @params size        Cells along each axis.
+     *  @params stride      Lattice steps per cell, a power of two.
+     *  @params iso         Iso value of the surface.
+     *  @params transitions Faces bordering finer chunks, a mask of MC_LOD_*.
+     *  @params fill        Samples the field.
+     *  @params gradient    Gradient of the field at a point in lattice steps.
+     *
+     *  @return A newly allocated, indexed mesh object.
+     */
+    static Mesh* generate_lod(int x, int y, int z, int size, int stride, float iso, int transitions,
+                              const DensityBox& fill, const DensityGradient& gradient);
+
+    /**
+     *  Runs multi-resolution density marching cubes on one chunk without
+     *  uploading anything to the GPU.
+     *
+     *  @params vertices    Receives the welded vertices.
+     *  @params indices     Receives three indices per face.
+     */
+    static void generate_lod(int x, int y, int z, int size, int stride, float iso, int transitions,
+                             const DensityBox& fill, const DensityGradient& gradient,
+                             std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+    /**
+     *  Indexed marching cubes over a volume that does not have to fit in
+     *  memory. The volume is read a slab of planes at a time, pages of
+     *  finished slabs are handed back, and vertices are written to the mesh
+     *  file as soon as no later face can touch them. Resident memory stays
+     *  around one slab plus two planes of vertices. The mesh is the same as
+     *  generate_indexed() gives for the whole volume in a Grid.
+     * 
+     *  Indices are written as uint32_t, so a mesh holds at most 2^32
+     *  vertices even though the header counts are 64 bit. Writing stops
+     *  once a volume needs more. The mesh file is removed on any error.
+     * 
+     *  @params volume  A mapped volume of cells.
+     *  @params path    Mesh file to write, see MeshFileHeader.
+     *  @params stats   Optional, receives the counts and throughput.
+     *  @params slab    Planes of cells per slab.
+     * 
+     *  @return CODE_SUCCESS if success, CODE_INVALID_FILENAME if the mesh
+     *          file cannot be created, CODE_INDEX_OUT_OF_BOUNDS if the mesh
+     *          has more than 2^32 vertices or CODE_READING_ERROR, which
+     *          also stands for failed writes and a failed tmpfile() here.
+     */
+    static int generate_file(MappedGrid* volume, const char* path, MeshFileStats* stats = nullptr,
+                             int slab = MC_FILE_SLAB);
+
+    /**
+     *  Builds the case index of n cells along z from the four rows of cells
+     *  bounding them, any non-zero cell is solid. Uses the widest SIMD kernel
+     *  the running CPU supports.
+     * 
+     *  @params r00     Row at (x, y), must hold n + 1 cells
+     *  @params r10     Row at (x + 1, y)
+     *  @params r01     Row at (x, y + 1)
+     *  @params r11     Row at (x + 1, y + 1)
+     *  @params n       Number of cells to classify
+     *  @params cases   Receives the n case indices
+     *  @params active  Receives the z of every cell with a case other than 0 or 255
+     * 
+     *  @return The number of entries written to active.
+     */
+    static int classify_row(const uint8_t* r00, const uint8_t* r10, const uint8_t* r01, const uint8_t* r11,
+                            int n, uint8_t* cases, int* active);
 };
 
 #endif
@@ -1,4 +1,255 @@
+#ifndef SIMPLEX_NOISE_H
+#define SIMPLEX_NOISE_H
+
+#include <stdint.h>
+
 #include "mcubes.h"
+#include "vector.h"
+
+
+// Noise values below this are solid
+#define SIMPLEX_THRESHOLD (-0.1)
+
+
+struct PermTable;
+
+
+// Row kernels of simplex_noise_row(), widest last
+enum NoiseKernel {
+    NOISE_KERNEL_SCALAR, NOISE_KERNEL_SSE2, NOISE_KERNEL_AVX2
+};
+
+
+/**
+ *  Where and how a SimplexNoise samples. Lattice point (i, j, k) lies at
+ *  origin + spacing * (i, j, k) in world space, and the noise is sampled at
+ *  frequency times that position.
+ */
+struct NoiseParams {
+    uint32_t seed = 0;          // 0 keeps the permutation of simplex_noise()
+    float frequency = 1.0f;     // Noise lattice cells per world unit
+    vec3 origin = {0.0f, 0.0f, 0.0f};
+    float spacing = 1.0f;
+};
+
+
+/**
+ *  Seeded simplex noise over a world-space lattice. Each sample depends on
+ *  its lattice index alone, so chunks can fill their own sub-regions in any
+ *  order and on any number of threads, and still agree bit for bit wherever
+ *  they overlap. The const members are safe to call concurrently.
+ */
+class SimplexNoise {
+private:
+    PermTable *m_table;
+    NoiseParams m_params;
+    vec3 m_origin;
+    float m_step;
+public:
+    /**
+     *  Builds the permutation tables of the seed.
+     *
+     *  @param params   Seed and placement of the lattice
+     */
+    SimplexNoise(const NoiseParams &params = NoiseParams());
+
+    /**
+     *  Deletes the permutation tables.
+     */
+    ~SimplexNoise();
+
+    /**
+     *  @return The parameters the noise was built with
+     */
+    const NoiseParams &params() const;
+
+    /**
+     *  Samples the noise at a world-space point. Lattice points should go
+     *  through lattice() to match the box fills exactly.
+     *
+     *  @return Noise value in the range [-1:1]
+     */
+    float sample(float x, float y, float z) const;
+
+    /**
+     *  Samples the noise and its analytic gradient at a world-space point.
+     *
+     *  @param grad Receives the gradient per world unit
+     *
+     *  @return Noise value, bit identical to sample(x, y, z)
+     */
+    float sample(float x, float y, float z, vec3 grad) const;
+
+    /**
+     *  Samples the noise at lattice point (i, j, k), bit identical to the
+     *  same point of any box fill.
+     *
+     *  @return Noise value in the range [-1:1]
+     */
+    float lattice(int i, int j, int k) const;
 
+    /**
+     *  Samples the noise and its analytic gradient anywhere between lattice
+     *  points, e.g. at a mesh vertex of a grid filled from lattice point
+     *  (x, y, z) at lattice(x + vx, y + vy, z + vz, grad).
+     *
+     *  @param grad Receives the gradient per lattice step, the unit of
+     *              central differences over a box fill
+     *
+     *  @return Noise value
+     */
+    float lattice(float i, float j, float k, vec3 grad) const;
 
+    /**
+     *  Samples a box of lattice points, rows along z are split between the
+     *  workers.
+     *
+     *  @param x        Lattice x of the first sample
+     *  @param y        Lattice y of the first sample
+     *  @param z        Lattice z of the first sample
+     *  @param size_x   Number of samples along x
+     *  @param size_y   Number of samples along y
+     *  @param size_z   Number of samples along z
+     *  @param out      Receives the samples, ((i * size_y) + j) * size_z + k
+     *  @param pool     Optional worker pool, nullptr samples on the calling thread
+     */
+    void sample(int x, int y, int z, int size_x, int size_y, int size_z, float *out,
+                ThreadPool *pool = nullptr) const;
+
+    /**
+     *  Fills a DensityGrid with the box of lattice points whose first corner
+     *  is (x, y, z).
+     *
+     *  @param pool     Optional worker pool, nullptr fills on the calling thread
+     */
+    void fill(DensityGrid *grid, int x, int y, int z, ThreadPool *pool = nullptr) const;
+
+    /**
+     *  Fills a DensityGrid with every stride-th lattice point from (x, y, z)
+     *  on, grid sample (i, j, k) is lattice point
+     *  (x + stride * i, y + stride * j, z + stride * k). With stride a power
+     *  of two and z a multiple of it, every sample is bit identical to the
+     *  same lattice point of a fill with stride 1, so coarse and fine grids
+     *  agree wherever their samples meet.
+     *
+     *  @param pool     Optional worker pool, nullptr fills on the calling thread
+     */
+    void fill(DensityGrid *grid, int x, int y, int z, int stride, ThreadPool *pool = nullptr) const;
+
+    /**
+     *  Fills a Grid with cells that are solid wherever the noise of the box
+     *  of lattice points whose first corner is (x, y, z) is below
+     *  SIMPLEX_THRESHOLD.
+     *
+     *  @param pool     Optional worker pool, nullptr fills on the calling thread
+     */
+    void fill(Grid *grid, int x, int y, int z, ThreadPool *pool = nullptr) const;
+
+    /**
+     *  Meshes the surface at SIMPLEX_THRESHOLD through the box of lattice
+     *  points whose first corner is (x, y, z) with normals from the noise
+     *  gradient. Planes of the box are sampled one at a time and dropped
+     *  once meshed, so no grid of the whole box is ever allocated. Vertices
+     *  are in lattice steps from (x, y, z), the same mesh as fill() into a
+     *  DensityGrid followed by MarchingCubeGenerator::generate().
+     *
+     *  @param vertices Receives the welded vertices
+     *  @param indices  Receives three indices per face
+     *  @param pool     Optional worker pool, nullptr samples on the calling thread
+     */
+    void mesh(int x, int y, int z, int size_x, int size_y, int size_z,
+              std::vector<Vertex> &vertices, std::vector<unsigned int> &indices,
+              ThreadPool *pool = nullptr) const;
+
+    /**
+     *  @return A newly allocated, indexed mesh of the box, see above
+     */
+    Mesh *mesh(int x, int y, int z, int size_x, int size_y, int size_z, ThreadPool *pool = nullptr) const;
+};
+
+
+/**
+ *  Samples 3D simplex noise at a point.
+ * 
+ *  @param x    x coordinate
+ *  @param y    y coordinate
+ *  @param z    z coordinate
+ * 
+ *  @return Noise value in the range [-1:1]
+ */
+double simplex_noise(double x, double y, double z);
+
+/**
+ *  Single precision version of simplex_noise(double, double, double), the
+ *  scalar reference of simplex_noise_row(). Differs from the double version
+ *  by float rounding only.
+ * 
+ *  @param x    x coordinate
+ *  @param y    y coordinate
+ *  @param z    z coordinate
+ * 
+ *  @return Noise value in the range [-1:1]
+ */
+float simplex_noise_float(float x, float y, float z);
+
+/**
+ *  simplex_noise_float() along with its analytic gradient, both from the
+ *  same pass over the simplex corners. Replaces the six extra samples of
+ *  central differences when shading.
+ * 
+ *  @param x    x coordinate
+ *  @param y    y coordinate
+ *  @param z    z coordinate
+ *  @param grad Receives the gradient of the noise at the point
+ * 
+ *  @return Noise value, bit identical to simplex_noise_float()
+ */
+float simplex_noise_grad(float x, float y, float z, vec3 grad);
+
+/**
+ *  Samples n points along z in single precision, out[i] is the noise at
+ *  (x, y, z + dz * i). Uses the widest SIMD kernel the running CPU supports,
+ *  each sample matches simplex_noise_float().
+ * 
+ *  @param x    x coordinate of the row
+ *  @param y    y coordinate of the row
+ *  @param z    z coordinate of the first sample
+ *  @param dz   Distance between samples
+ *  @param n    Number of samples
+ *  @param out  Receives the n noise values
+ */
+void simplex_noise_row(float x, float y, float z, float dz, int n, float *out);
+
+/**
+ *  simplex_noise_row() on the given kernel rather than the one picked at
+ *  startup, so every kernel the CPU runs can be tested against the scalar
+ *  one. The kernel must be supported, see simplex_noise_has_kernel().
+ * 
+ *  @param kernel   Kernel to sample with
+ */
+void simplex_noise_row(NoiseKernel kernel, float x, float y, float z, float dz, int n, float *out);
+
+/**
+ *  @return true if the kernel is compiled in and the running CPU supports it
+ */
+bool simplex_noise_has_kernel(NoiseKernel kernel);
+
+/**
+ *  Fills a Grid with cells that are solid wherever the noise is below
+ *  SIMPLEX_THRESHOLD. Same as SimplexNoise().fill(grid, 0, 0, 0).
+ * 
+ *  @param grid     Grid to fill, sampled at its integer cell coordinates
+ */
 void simplex_noise(Grid *grid);
+
+/**
+ *  Fills a DensityGrid with raw noise values, mesh it with
+ *  SIMPLEX_THRESHOLD as the iso value to match simplex_noise(Grid*). Same
+ *  as SimplexNoise().fill(grid, 0, 0, 0).
+ * 
+ *  @param grid     DensityGrid to fill, sampled at its integer coordinates
+ */
+void simplex_noise(DensityGrid *grid);
+
+
+#endif
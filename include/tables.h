@@ -17,42 +17,14 @@
 #ifndef TABLES_H
 #define TABLES_H
 
-const unsigned int MC_EDGE_TABLE[256] = {
-	0x0  , 0x109, 0x203, 0x30a, 0x406, 0x50f, 0x605, 0x70c,
-	0x80c, 0x905, 0xa0f, 0xb06, 0xc0a, 0xd03, 0xe09, 0xf00,
-	0x190, 0x99 , 0x393, 0x29a, 0x596, 0x49f, 0x795, 0x69c,
-	0x99c, 0x895, 0xb9f, 0xa96, 0xd9a, 0xc93, 0xf99, 0xe90,
-	0x230, 0x339, 0x33 , 0x13a, 0x636, 0x73f, 0x435, 0x53c,
-	0xa3c, 0xb35, 0x83f, 0x936, 0xe3a, 0xf33, 0xc39, 0xd30,
-	0x3a0, 0x2a9, 0x1a3, 0xaa , 0x7a6, 0x6af, 0x5a5, 0x4ac,
-	0xbac, 0xaa5, 0x9af, 0x8a6, 0xfaa, 0xea3, 0xda9, 0xca0,
-	0x460, 0x569, 0x663, 0x76a, 0x66 , 0x16f, 0x265, 0x36c,
-	0xc6c, 0xd65, 0xe6f, 0xf66, 0x86a, 0x963, 0xa69, 0xb60,
-	0x5f0, 0x4f9, 0x7f3, 0x6fa, 0x1f6, 0xff , 0x3f5, 0x2fc,
-	0xdfc, 0xcf5, 0xfff, 0xef6, 0x9fa, 0x8f3, 0xbf9, 0xaf0,
-	0x650, 0x759, 0x453, 0x55a, 0x256, 0x35f, 0x55 , 0x15c,
-	0xe5c, 0xf55, 0xc5f, 0xd56, 0xa5a, 0xb53, 0x859, 0x950,
-	0x7c0, 0x6c9, 0x5c3, 0x4ca, 0x3c6, 0x2cf, 0x1c5, 0xcc ,
-	0xfcc, 0xec5, 0xdcf, 0xcc6, 0xbca, 0xac3, 0x9c9, 0x8c0,
-	0x8c0, 0x9c9, 0xac3, 0xbca, 0xcc6, 0xdcf, 0xec5, 0xfcc,
-	0xcc , 0x1c5, 0x2cf, 0x3c6, 0x4ca, 0x5c3, 0x6c9, 0x7c0,
-	0x950, 0x859, 0xb53, 0xa5a, 0xd56, 0xc5f, 0xf55, 0xe5c,
-	0x15c, 0x55 , 0x35f, 0x256, 0x55a, 0x453, 0x759, 0x650,
-	0xaf0, 0xbf9, 0x8f3, 0x9fa, 0xef6, 0xfff, 0xcf5, 0xdfc,
-	0x2fc, 0x3f5, 0xff , 0x1f6, 0x6fa, 0x7f3, 0x4f9, 0x5f0,
-	0xb60, 0xa69, 0x963, 0x86a, 0xf66, 0xe6f, 0xd65, 0xc6c,
-	0x36c, 0x265, 0x16f, 0x66 , 0x76a, 0x663, 0x569, 0x460,
-	0xca0, 0xda9, 0xea3, 0xfaa, 0x8a6, 0x9af, 0xaa5, 0xbac,
-	0x4ac, 0x5a5, 0x6af, 0x7a6, 0xaa , 0x1a3, 0x2a9, 0x3a0,
-	0xd30, 0xc39, 0xf33, 0xe3a, 0x936, 0x83f, 0xb35, 0xa3c,
-	0x53c, 0x435, 0x73f, 0x636, 0x13a, 0x33 , 0x339, 0x230,
-	0xe90, 0xf99, 0xc93, 0xd9a, 0xa96, 0xb9f, 0x895, 0x99c,
-	0x69c, 0x795, 0x49f, 0x596, 0x29a, 0x393, 0x99 , 0x190,
-	0xf00, 0xe09, 0xd03, 0xc0a, 0xb06, 0xa0f, 0x905, 0x80c,
-	0x70c, 0x605, 0x50f, 0x406, 0x30a, 0x203, 0x109, 0x0
-};
+#include <stdint.h>
+#include <array>
+
 
-const int MC_TRI_TABLE[256][16] = {
+// Edges of the triangles of every case, three per triangle, -1 past the
+// last one. The compact tables at the bottom are built from it at compile
+// time so nothing has to scan for the -1.
+inline constexpr int8_t MC_TRI_TABLE[256][16] = {
 	{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
 	{ 0, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
 	{ 0, 1, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
@@ -311,7 +283,8 @@ const int MC_TRI_TABLE[256][16] = {
 	{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 }
 };
 
-const float MC_OFFSETS[12][3] = {
+// Midpoint of every edge relative to the cell corner.
+inline constexpr float MC_OFFSETS[12][3] = {
 	{0.5, 0.0, 0.0},
 	{1.0, 0.0, 0.5},
 	{0.5, 0.0, 1.0},
@@ -326,4 +299,77 @@ const float MC_OFFSETS[12][3] = {
 	{0.0, 0.5, 1.0},
 };
 
+// Lattice corner {x, y, z} an edge starts at and the axis it runs along.
+// Lets neighbouring cells agree on a single id for a shared edge.
+inline constexpr int8_t MC_EDGE_ORIGIN[12][4] = {
+	{0, 0, 0, 0},
+	{1, 0, 0, 2},
+	{0, 0, 1, 0},
+	{0, 0, 0, 2},
+	{0, 1, 0, 0},
+	{1, 1, 0, 2},
+	{0, 1, 1, 0},
+	{0, 1, 0, 2},
+	{0, 0, 0, 1},
+	{1, 0, 0, 1},
+	{1, 0, 1, 1},
+	{0, 0, 1, 1},
+};
+
+// Faces of a transition cell of zero width as rings of its samples, -1 past
+// the last one. Samples 0 - 8 lie on the fine face, s / 3 and s % 3 steps
+// along the two other axes, 9 - 12 are the corners of the coarse face,
+// (s - 9) / 2 and (s - 9) % 2 steps. Rings wind counter-clockwise seen from
+// outside of the cell when the coarse face lies along +axis of the fine one.
+inline constexpr int8_t MC_TRANSITION_FACES[9][5] = {
+	{ 0, 1, 4, 3, -1 },
+	{ 1, 2, 5, 4, -1 },
+	{ 3, 4, 7, 6, -1 },
+	{ 4, 5, 8, 7, -1 },
+	{ 9, 11, 12, 10, -1 },
+	{ 9, 10, 2, 1, 0 },
+	{ 6, 7, 8, 12, 11 },
+	{ 0, 3, 6, 11, 9 },
+	{ 10, 12, 8, 5, 2 },
+};
+
+
+// Number of triangles of every case.
+inline constexpr std::array<uint8_t, 256> MC_TRI_COUNT = [] {
+	std::array<uint8_t, 256> count = {};
+	
+	for (int c = 0; c < 256; c++) {
+		int n = 0;
+		while (n < 15 && MC_TRI_TABLE[c][n] != -1) n += 3;
+		count[c] = (uint8_t) (n / 3);
+	}
+	return count;
+}();
+
+// Bit e set for every edge e the surface of a case crosses.
+inline constexpr std::array<uint16_t, 256> MC_EDGE_TABLE = [] {
+	std::array<uint16_t, 256> edges = {};
+	
+	for (int c = 0; c < 256; c++) {
+		for (int i = 0; i < MC_TRI_COUNT[c] * 3; i++) {
+			edges[c] |= (uint16_t) (1 << MC_TRI_TABLE[c][i]);
+		}
+	}
+	return edges;
+}();
+
+// The edges of MC_TRI_TABLE as the edge cache slot of each vertex:
+// x | y << 1 | z << 2 | axis << 3 from MC_EDGE_ORIGIN, relative to the cell.
+inline constexpr std::array<std::array<uint8_t, 15>, 256> MC_TRI_SLOTS = [] {
+	std::array<std::array<uint8_t, 15>, 256> slots = {};
+	
+	for (int c = 0; c < 256; c++) {
+		for (int i = 0; i < MC_TRI_COUNT[c] * 3; i++) {
+			const int8_t *o = MC_EDGE_ORIGIN[MC_TRI_TABLE[c][i]];
+			slots[c][i] = (uint8_t) (o[0] | (o[1] << 1) | (o[2] << 2) | (o[3] << 3));
+		}
+	}
+	return slots;
+}();
+
 #endif
\ No newline at end of file
@@ -0,0 +1,163 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef TERRAIN_LOD_H
+#define TERRAIN_LOD_H
+
+#include <map>
+#include <vector>
+
+#include "mcubes.h"
+#include "mesh.h"
+#include "thread_pool.h"
+#include "vector.h"
+
+
+// Cells per edge of a chunk at every level
+#define TERRAIN_LOD_SIZE    (16)
+
+// Levels of detail, each twice as coarse as the last and reaching twice as far
+#define TERRAIN_LOD_LEVELS  (5)
+
+// Chunks from the middle of a level to its edge, even and at least 4 so a
+// chunk never borders one more than a level away
+#define TERRAIN_LOD_RADIUS  (4)
+
+
+/**
+ *  A chunk of the terrain: where it is, how coarse, and which faces border
+ *  finer chunks. Chunk corners are in lattice steps.
+ */
+struct TerrainChunk {
+    int level;
+    int x, y, z;
+    int transitions;        // Mask of MC_LOD_*
+
+    bool operator<(const TerrainChunk &other) const;
+};
+
+
+/**
+ *  CPU side result of meshing one terrain chunk, waiting to be uploaded.
+ */
+struct TerrainChunkData {
+    TerrainChunk chunk;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+
+/**
+ *  Meshes a density field around a viewer at falling resolution. Level l
+ *  is a cube of chunks with 2^l lattice steps per cell, centered on the
+ *  viewer, with the cube of level l - 1 cut out of it. Every level holds
+ *  the same number of chunks and reaches twice as far as the last, so
+ *  triangles and memory grow with the log of the view distance instead of
+ *  its cube. Chunks bordering a finer level stitch the seam with transition
+ *  cells, see MarchingCubeGenerator::generate_lod().
+ *
+ *  Chunks are kept while the viewer moves and only those that enter a level
+ *  or change seams are meshed again.
+ */
+class TerrainLod {
+private:
+    DensityBox m_fill;
+    DensityGradient m_gradient;
+    float m_iso;
+    int m_size;
+    int m_levels;
+    int m_radius;
+    std::map<TerrainChunk, Mesh*> m_meshes;
+    std::vector<TerrainChunk> m_stale;
+    std::vector<TerrainChunkData> m_pending;
+
+    void release(Mesh *mesh);
+public:
+    /**
+     *  Constructs a TerrainLod, nothing is meshed until build().
+     *
+     *  @param fill         Samples the field, see DensityBox
+     *  @param gradient     Gradient of the field at a point in lattice steps
+     *  @param iso          Iso value of the surface, samples below it are solid
+     *  @param size         Cells per edge of a chunk
+     *  @param levels       Number of levels of detail
+     *  @param radius       Chunks from the middle of a level to its edge,
+     *                      rounded up to an even number of at least 4
+     */
+    TerrainLod(const DensityBox &fill, const DensityGradient &gradient, float iso,
+               int size = TERRAIN_LOD_SIZE, int levels = TERRAIN_LOD_LEVELS, int radius = TERRAIN_LOD_RADIUS);
+
+    /**
+     *  Deletes every chunk mesh.
+     */
+    ~TerrainLod();
+
+    /**
+     *  Lists the chunks covering the view from a point. Neighbouring chunks
+     *  are at most one level apart.
+     *
+     *  @param viewer   Where the view is from, in lattice steps
+     *  @param chunks   Receives the chunks, finest level first
+     */
+    void select(const vec3 viewer, std::vector<TerrainChunk> &chunks) const;
+
+    /**
+     *  Meshes the chunks the view from a point needs that are not meshed
+     *  yet. Does not touch GL, so it may run off the render thread.
+     *
+     *  The fill and gradient may use the same pool, e.g. to fill a chunk
+     *  with SimplexNoise::fill(), but get no extra threads from it while
+     *  the chunks are meshed in parallel, see ThreadPool::run().
+     *
+     *  @param viewer   Where the view is from, in lattice steps
+     *  @param pool     Optional worker pool to mesh chunks in parallel
+     *
+     *  @return Number of chunks meshed
+     */
+    int build(const vec3 viewer, ThreadPool *pool = nullptr);
+
+    /**
+     *  Uploads the chunks meshed by build() and deletes the meshes of
+     *  chunks the view no longer needs.
+     *
+     *  @return Number of chunks uploaded
+     */
+    int upload();
+
+    /**
+     *  build() followed by upload().
+     *
+     *  @return Number of chunks meshed
+     */
+    int update(const vec3 viewer, ThreadPool *pool = nullptr);
+
+    /**
+     *  Renders every non-empty chunk. Shader is not bound in this function.
+     */
+    void render();
+
+    /**
+     *  @return Number of chunks uploaded, empty ones included
+     */
+    int chunks() const;
+
+    /**
+     *  @return Lattice steps from the viewer to the edge of the coarsest level
+     */
+    int reach() const;
+};
+
+
+#endif
@@ -0,0 +1,93 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class ThreadPool {
+private:
+    std::vector<std::thread> m_threads;
+    std::mutex m_lock;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+
+    const std::function<void(int)> *m_job;
+    unsigned long m_generation;
+    int m_pending;
+    bool m_stop;
+
+    void worker(int id);
+public:
+    /**
+     *  Constructs a new ThreadPool. The calling thread takes part in every
+     *  job as worker 0, so only threads - 1 threads are spawned.
+     *
+     *  @param threads  Number of workers, 0 uses the hardware concurrency.
+     */
+    ThreadPool(int threads = 0);
+
+    /**
+     *  Joins all worker threads.
+     */
+    ~ThreadPool();
+
+    /**
+     *  @return The number of workers including the calling thread.
+     */
+    int size() const;
+
+    /**
+     *  Runs a job once on every worker and waits for all of them to finish.
+     *
+     *  The pool runs one job at a time and is not reentrant. Only one thread
+     *  may call run(), split() or for_each() at once. A job may call them on
+     *  its own pool, but such a nested call gets no extra threads: it runs
+     *  every worker id in turn on the calling thread.
+     *
+     *  @param job  Function called with the id of the worker in [0:size)
+     */
+    void run(const std::function<void(int worker)> &job);
+
+    /**
+     *  Splits [begin:end) into size() contiguous chunks, worker i always
+     *  receives the i-th chunk. Use this when the same partition must land on
+     *  the same thread every call (e.g. first-touch allocation).
+     *
+     *  @param begin    First index of the range
+     *  @param end      One past the last index of the range
+     *  @param job      Function called with the chunk [lo:hi)
+     */
+    void split(int begin, int end, const std::function<void(int lo, int hi)> &job);
+
+    /**
+     *  Hands out the indices [0:n) one at a time to whichever worker is
+     *  free. Use this when the cost per index is uneven.
+     *
+     *  @param n    Number of indices
+     *  @param job  Function called with each index
+     */
+    void for_each(int n, const std::function<void(int i)> &job);
+};
+
+
+#endif
@@ -20,7 +20,9 @@
 #include <GLFW/glfw3.h>
 
 #include <camera.h>
+#include "chunk_mesher.h"
 #include "conway.h"
+#include "life_worker.h"
 #include <day_cycle.h>
 #include <engine.h>
 #include <framebuffer.h>
@@ -58,6 +60,8 @@ typedef struct {
 
     // Conway
     GameOfLife* life; 
+    ChunkMesher* life_mesh;
+    LifeWorker* life_worker;
 
 } World;
 
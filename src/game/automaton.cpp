@@ -0,0 +1,69 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#include "automaton.h"
+#include "conway.h"
+
+#include <string.h>
+
+
+/**
+ *  Factory for one instantiation, what the registry stores per rule.
+ */
+template <uint64_t Birth, uint64_t Survive, Neighborhood N, int Radius, int States>
+static CellularAutomaton* create(int x, int y, int z) {
+	return new Automaton<Birth, Survive, N, Radius, States>(x, y, z);
+}
+
+
+#define R automaton_range
+
+// Notation is survive/birth/states/neighborhood
+static const AutomatonRule RULES[] = {
+	{ "conway", "5-7/6/2/M",
+		create<R(CONWAY_BIRTH_LOW, CONWAY_BIRTH_HIGH), R(CONWAY_SURVIVE_LOW, CONWAY_SURVIVE_HIGH), NEIGHBORHOOD_MOORE, 1, 2> },
+	{ "445", "4/4/5/M",
+		create<R(4, 4), R(4, 4), NEIGHBORHOOD_MOORE, 1, 5> },
+	{ "amoeba", "9-26/5-7,12-13,15/5/M",
+		create<R(5, 7) | R(12, 13) | R(15, 15), R(9, 26), NEIGHBORHOOD_MOORE, 1, 5> },
+	{ "builder", "2,6,9/4,6,8-9/10/M",
+		create<R(4, 4) | R(6, 6) | R(8, 9), R(2, 2) | R(6, 6) | R(9, 9), NEIGHBORHOOD_MOORE, 1, 10> },
+	{ "clouds", "13-26/13-14,17-19/2/M",
+		create<R(13, 14) | R(17, 19), R(13, 26), NEIGHBORHOOD_MOORE, 1, 2> },
+	{ "crystal", "0-6/1,3/2/N",
+		create<R(1, 1) | R(3, 3), R(0, 6), NEIGHBORHOOD_VON_NEUMANN, 1, 2> },
+	{ "pyroclastic", "4-7/6-8/10/M",
+		create<R(6, 8), R(4, 7), NEIGHBORHOOD_MOORE, 1, 10> },
+	{ "slow_decay", "13-26/10-26/3/M",
+		create<R(10, 26), R(13, 26), NEIGHBORHOOD_MOORE, 1, 3> },
+};
+
+#undef R
+
+
+const AutomatonRule* automaton_rules(int *count) {
+	*count = (int) (sizeof(RULES) / sizeof(RULES[0]));
+	return RULES;
+}
+
+
+CellularAutomaton* automaton_create(const char *name, int x, int y, int z) {
+	int i;
+
+	for (i = 0; i < (int) (sizeof(RULES) / sizeof(RULES[0])); i++) {
+		if (strcmp(RULES[i].name, name) == 0) return RULES[i].create(x, y, z);
+	}
+	return nullptr;
+}
@@ -0,0 +1,172 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#include "chunk_mesher.h"
+
+#include <algorithm>
+
+#include "mcubes.h"
+
+
+ChunkMesher::ChunkMesher(int x, int y, int z, int size) {
+	this->x = x;
+	this->y = y;
+	this->z = z;
+	this->m_size = size;
+	
+	// Chunks are made of cells, one fewer than samples along each axis
+	this->cx = std::max(x - 1 + size - 1, 0) / size;
+	this->cy = std::max(y - 1 + size - 1, 0) / size;
+	this->cz = std::max(z - 1 + size - 1, 0) / size;
+	
+	this->m_meshes.assign(this->cx * this->cy * this->cz, nullptr);
+	this->m_dirty.assign(this->cx * this->cy * this->cz, 1);
+}
+
+
+ChunkMesher::~ChunkMesher() {
+	int c;
+	
+	for (c = 0; c < (int) this->m_meshes.size(); c++) {
+		release(c);
+	}
+}
+
+
+void ChunkMesher::mark(Grid* grid, const std::vector<int>& bricks) {
+	int lo[3], hi[3], cells[3] = { this->x - 1, this->y - 1, this->z - 1 };
+	int i, j, k, axis, b;
+	
+	for (int brick : bricks) {
+		int pos[3] = {
+			brick / (grid->by * grid->bz),
+			(brick / grid->bz) % grid->by,
+			brick % grid->bz
+		};
+		
+		for (axis = 0; axis < 3; axis++) {
+			b = pos[axis] << GRID_BRICK_SHIFT;
+			lo[axis] = std::max(b - 1, 0) / this->m_size;
+			hi[axis] = (std::min(b + GRID_BRICK, cells[axis]) - 1) / this->m_size;
+		}
+		
+		for (i = lo[0]; i <= hi[0]; i++) {
+			for (j = lo[1]; j <= hi[1]; j++) {
+				for (k = lo[2]; k <= hi[2]; k++) {
+					this->m_dirty[(i * this->cy * this->cz) + (j * this->cz) + k] = 1;
+				}
+			}
+		}
+	}
+}
+
+
+void ChunkMesher::mark_all() {
+	std::fill(this->m_dirty.begin(), this->m_dirty.end(), 1);
+}
+
+
+int ChunkMesher::build(Grid* grid, ThreadPool* pool) {
+	std::vector<int> dirty;
+	int c, first;
+	
+	for (c = 0; c < (int) this->m_dirty.size(); c++) {
+		if (this->m_dirty[c]) dirty.push_back(c);
+		this->m_dirty[c] = 0;
+	}
+	
+	first = (int) this->m_pending.size();
+	this->m_pending.resize(first + dirty.size());
+	
+	auto mesh_chunk = [&](int i) {
+		ChunkData &data = this->m_pending[first + i];
+		int c = dirty[i];
+		int x0 = (c / (this->cy * this->cz)) * this->m_size;
+		int y0 = ((c / this->cz) % this->cy) * this->m_size;
+		int z0 = (c % this->cz) * this->m_size;
+		
+		data.chunk = c;
+		MarchingCubeGenerator::generate_indexed(grid, x0, y0, z0,
+			std::min(x0 + this->m_size, grid->x - 1),
+			std::min(y0 + this->m_size, grid->y - 1),
+			std::min(z0 + this->m_size, grid->z - 1),
+			data.vertices, data.indices);
+	};
+	
+	if (pool) {
+		pool->for_each((int) dirty.size(), mesh_chunk);
+	} else {
+		for (c = 0; c < (int) dirty.size(); c++) {
+			mesh_chunk(c);
+		}
+	}
+	return (int) dirty.size();
+}
+
+
+int ChunkMesher::upload() {
+	return upload(this->m_pending);
+}
+
+
+void ChunkMesher::take(std::vector<ChunkData>& out) {
+	out.swap(this->m_pending);
+	this->m_pending.clear();
+}
+
+
+int ChunkMesher::upload(std::vector<ChunkData>& chunks) {
+	int n = (int) chunks.size();
+	
+	for (ChunkData &data : chunks) {
+		release(data.chunk);
+		if (data.indices.empty()) continue;
+		
+		Mesh *mesh = new Mesh();
+		mesh_create(mesh, data.vertices.data(), data.vertices.size(), data.indices.data(), data.indices.size());
+		this->m_meshes[data.chunk] = mesh;
+	}
+	chunks.clear();
+	return n;
+}
+
+
+int ChunkMesher::update(Grid* grid, ThreadPool* pool) {
+	build(grid, pool);
+	return upload();
+}
+
+
+void ChunkMesher::render() {
+	for (Mesh *mesh : this->m_meshes) {
+		if (mesh) mesh_render(mesh);
+	}
+}
+
+
+int ChunkMesher::chunks() const {
+	return this->cx * this->cy * this->cz;
+}
+
+
+// Private helper functions
+
+void ChunkMesher::release(int chunk) {
+	if (!this->m_meshes[chunk]) return;
+	
+	mesh_delete(this->m_meshes[chunk]);
+	delete this->m_meshes[chunk];
+	this->m_meshes[chunk] = nullptr;
+}
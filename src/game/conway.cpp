@@ -15,13 +15,36 @@
 */
 #include "conway.h"
 
+#include <string.h>
+#include <algorithm>
 
-GameOfLife::GameOfLife(int x, int y, int z) {
+#include "common.h"
+
+
+GameOfLife::GameOfLife(int x, int y, int z, ThreadPool* pool, bool first_touch) {
 	this->m_current = new Grid(x, y, z);
 	this->m_next = new Grid(x, y, z);
-	this->x = x;
-	this->y = y;
-	this->z = z;
+	this->m_pool = pool;
+	this->x = this->m_current->x;
+	this->y = this->m_current->y;
+	this->z = this->m_current->z;
+	
+	this->m_hashes.assign(this->m_current->bx * this->m_current->by * this->m_current->bz, 0);
+	this->m_history.assign(CONWAY_PERIOD_MAX, 0);
+	reset_cycle();
+	
+	if (!pool || !first_touch) return;
+	
+	// Fault the pages of both grids in from the workers that will step them,
+	// using the same brick-aligned partition as step()
+	pool->split(0, this->m_current->bx, [this](int b0, int b1) {
+		int x0 = b0 << GRID_BRICK_SHIFT;
+		int x1 = std::min(b1 << GRID_BRICK_SHIFT, this->x);
+		size_t len = (size_t) (x1 - x0) * this->y * this->z;
+		
+		memset(this->m_current->m_cells + this->m_current->index(x0, 0, 0), 0, len);
+		memset(this->m_next->m_cells + this->m_next->index(x0, 0, 0), 0, len);
+	});
 }
 
 
@@ -35,20 +58,215 @@ GameOfLife::~GameOfLife() {
 
 
 void GameOfLife::populate(int percent) {
-	int n = this->x * this->y * this->z;
-	int c;
+	size_t i, cells = (size_t) this->x * this->y * this->z;
+	int n, c;
+	
+	for (i = 0; i < cells; i++) {
+		this->m_current->m_cells[i] = ((rand() % 100) < percent);
+	}
+	this->m_current->update_bricks();
 	
+	n = this->m_current->bx * this->m_current->by * this->m_current->bz;
+	this->m_changed.resize(n);
 	for (c = 0; c < n; c++) {
-		this->m_current->m_cells[c] = ((rand() % 100) < percent);
+		this->m_changed[c] = c;
+		this->m_hashes[c] = hash_brick(c);
 	}
+	reset_cycle();
 }
 
 
 void GameOfLife::step() {
-	int c, x, y, z;
+	const int bricks = this->m_current->bx;
+	
+	if (this->m_period) {
+		replay();
+		return;
+	}
+	
+	if (!this->m_pool || this->m_pool->size() == 1) {
+		step_slab(0, this->x);
+		diff_bricks();
+	} else {
+		// Slabs are whole bricks wide, so each worker can diff its own bricks
+		// as soon as it has stepped them without waiting on its neighbors.
+		std::vector<std::vector<int>> parts(bricks);
+		
+		this->m_pool->split(0, bricks, [&](int b0, int b1) {
+			step_slab(b0 << GRID_BRICK_SHIFT, std::min(b1 << GRID_BRICK_SHIFT, this->x));
+			diff_slab(b0, b1, parts[b0]);
+		});
+		
+		this->m_changed.clear();
+		for (std::vector<int> &part : parts) {
+			this->m_changed.insert(this->m_changed.end(), part.begin(), part.end());
+		}
+	}
+
+	// m_current is only read and m_next only written, the pool joining is
+	// the only synchronization needed before the buffers trade places
+	Grid *temp = this->m_next;
+	m_next = m_current;
+	m_current = temp;
+	
+	track();
+}
+
+
+int GameOfLife::step_boxsum(int radius) {
+	// Counts of a larger box overflow the uint16_t sums
+	if (radius < 1 || radius > CONWAY_RADIUS_MAX) return CODE_INDEX_OUT_OF_BOUNDS;
+	
+	const int plane = this->y * this->z;
+	const int span = (2 * radius) + 1;
+	std::vector<uint16_t> ring((size_t) span * plane, 0);
+	std::vector<uint16_t> sum(plane, 0);
+	std::vector<uint16_t> tmp(plane);
+	int x, i, in, out;
+	
+	if (radius == 1 && this->m_period) {
+		replay();
+		return CODE_SUCCESS;
+	}
+	
+	// Prime the box sum with the planes in [-radius:radius], dead outside
+	for (x = 0; x <= radius && x < this->x; x++) {
+		sum_plane(x, radius, &ring[(size_t) (x % span) * plane], tmp.data());
+		for (i = 0; i < plane; i++) {
+			sum[i] += ring[((size_t) (x % span) * plane) + i];
+		}
+	}
+	
+	for (x = 0; x < this->x; x++) {
+		const uint8_t *cur = this->m_current->m_cells + this->m_current->index(x, 0, 0);
+		uint8_t *next = this->m_next->m_cells + this->m_next->index(x, 0, 0);
+		
+		for (i = 0; i < plane; i++) {
+			int n = sum[i] - cur[i];
+			uint8_t survive = (n >= CONWAY_SURVIVE_LOW && n <= CONWAY_SURVIVE_HIGH);
+			uint8_t birth = (n >= CONWAY_BIRTH_LOW && n <= CONWAY_BIRTH_HIGH);
+			next[i] = cur[i] ? survive : birth;
+		}
+		
+		// Slide the box one plane along x
+		in = x + radius + 1;
+		out = x - radius;
+		if (out >= 0) {
+			const uint16_t *old = &ring[(size_t) (out % span) * plane];
+			for (i = 0; i < plane; i++) {
+				sum[i] -= old[i];
+			}
+		}
+		if (in < this->x) {
+			uint16_t *add = &ring[(size_t) (in % span) * plane];
+			sum_plane(in, radius, add, tmp.data());
+			for (i = 0; i < plane; i++) {
+				sum[i] += add[i];
+			}
+		}
+	}
+	
+	diff_bricks();
+	
+	Grid *temp = this->m_next;
+	m_next = m_current;
+	m_current = temp;
+	
+	if (radius == 1) {
+		track();
+		return CODE_SUCCESS;
+	}
+	
+	// Other radii are a different rule, the cycle found so far is not theirs
+	for (int b : this->m_changed) {
+		this->m_hashes[b] = hash_brick(b);
+	}
+	reset_cycle();
+	return CODE_SUCCESS;
+}
+
+
+void GameOfLife::step_active() {
+	Grid *cur = this->m_current;
+	const int plane = cur->by * cur->bz;
+	const int bricks = cur->bx * plane;
+	std::vector<uint8_t> mark(bricks, 0);
+	std::vector<int> active;
+	int b, i, dx, dy, dz;
+	
+	if (this->m_period) {
+		replay();
+		return;
+	}
+	
+	// Bricks that changed last generation and their 26 neighbors are the
+	// only ones whose next generation can differ from the current one
+	for (int c : this->m_changed) {
+		int bx = c / plane;
+		int by = (c / cur->bz) % cur->by;
+		int bz = c % cur->bz;
+		
+		for (dx = std::max(bx - 1, 0); dx <= std::min(bx + 1, cur->bx - 1); dx++) {
+			for (dy = std::max(by - 1, 0); dy <= std::min(by + 1, cur->by - 1); dy++) {
+				for (dz = std::max(bz - 1, 0); dz <= std::min(bz + 1, cur->bz - 1); dz++) {
+					mark[(dx * plane) + (dy * cur->bz) + dz] = 1;
+				}
+			}
+		}
+	}
+	for (b = 0; b < bricks; b++) {
+		if (mark[b]) active.push_back(b);
+	}
+	
+	// Everything else is skipped: those bricks did not change last step, so
+	// m_next already holds the same cells and counts as m_current there
+	this->m_changed.clear();
+	if (!this->m_pool || this->m_pool->size() == 1) {
+		for (b = 0; b < (int) active.size(); b++) {
+			step_brick(active[b]);
+			if (diff_brick(active[b])) this->m_changed.push_back(active[b]);
+		}
+	} else {
+		std::vector<uint8_t> hit(active.size(), 0);
+		
+		this->m_pool->for_each((int) active.size(), [&](int i) {
+			step_brick(active[i]);
+			hit[i] = diff_brick(active[i]);
+		});
+		for (i = 0; i < (int) active.size(); i++) {
+			if (hit[i]) this->m_changed.push_back(active[i]);
+		}
+	}
+	
+	Grid *temp = this->m_next;
+	m_next = m_current;
+	m_current = temp;
+	
+	track();
+}
+
+
+const std::vector<int>& GameOfLife::changed() const {
+	return this->m_changed;
+}
+
+
+int GameOfLife::period() const {
+	return this->m_period;
+}
+
+
+// Private helper functions
+
+/**
+ *  Steps the cells in [x0:x1) from m_current into m_next.
+ */
+void GameOfLife::step_slab(int x0, int x1) {
+	size_t c;
+	int x, y, z;
 	int n;
 	
-	for (c = 0, x = 0; x < this->x; x++) {
+	for (c = this->m_current->index(x0, 0, 0), x = x0; x < x1; x++) {
 		for (y = 0; y < this->y; y++) {
 			for (z = 0; z < this->z; z++, c++) {
 				n = count_neigbors(x, y, z);
@@ -61,24 +279,330 @@ void GameOfLife::step() {
 			}
 		}
 	}
+}
+
+
+/**
+ *  Steps the cells of brick b from m_current into m_next.
+ */
+void GameOfLife::step_brick(int b) {
+	Grid *cur = this->m_current;
+	const int x0 = (b / (cur->by * cur->bz)) << GRID_BRICK_SHIFT;
+	const int y0 = ((b / cur->bz) % cur->by) << GRID_BRICK_SHIFT;
+	const int z0 = (b % cur->bz) << GRID_BRICK_SHIFT;
+	const int x1 = std::min(x0 + GRID_BRICK, this->x);
+	const int y1 = std::min(y0 + GRID_BRICK, this->y);
+	const int z1 = std::min(z0 + GRID_BRICK, this->z);
+	size_t c;
+	int x, y, z;
+	int n;
+	
+	for (x = x0; x < x1; x++) {
+		for (y = y0; y < y1; y++) {
+			for (c = cur->index(x, y, z0), z = z0; z < z1; z++, c++) {
+				n = count_neigbors(x, y, z);
+				
+				if (cur->m_cells[c]) { // Alive
+					this->m_next->m_cells[c] = (n >= CONWAY_SURVIVE_LOW && n <= CONWAY_SURVIVE_HIGH);
+				} else {
+					this->m_next->m_cells[c] = (n >= CONWAY_BIRTH_LOW && n <= CONWAY_BIRTH_HIGH);
+				}
+			}
+		}
+	}
+}
+
+
+/**
+ *  Sums the cells of plane x over a (2 * radius + 1)^2 square around every
+ *  cell, z first and then y, both as running sums.
+ */
+void GameOfLife::sum_plane(int x, int radius, uint16_t *out, uint16_t *tmp) {
+	const uint8_t *cells = this->m_current->m_cells + this->m_current->index(x, 0, 0);
+	int y, z, run;
+	
+	// Along z
+	for (y = 0; y < this->y; y++) {
+		const uint8_t *row = cells + (y * this->z);
+		uint16_t *dst = tmp + (y * this->z);
+		
+		for (run = 0, z = 0; z < radius && z < this->z; z++) {
+			run += row[z] != 0;
+		}
+		for (z = 0; z < this->z; z++) {
+			if (z + radius < this->z) run += row[z + radius] != 0;
+			if (z - radius - 1 >= 0) run -= row[z - radius - 1] != 0;
+			dst[z] = (uint16_t) run;
+		}
+	}
+	
+	// Along y, whole rows at a time
+	memset(out, 0, sizeof(uint16_t) * this->y * this->z);
+	for (y = 0; y < radius && y < this->y; y++) {
+		for (z = 0; z < this->z; z++) {
+			out[z] += tmp[(y * this->z) + z];
+		}
+	}
+	for (y = 0; y < this->y; y++) {
+		uint16_t *dst = out + (y * this->z);
+		
+		if (y > 0) memcpy(dst, dst - this->z, sizeof(uint16_t) * this->z);
+		if (y + radius < this->y) {
+			const uint16_t *add = tmp + ((y + radius) * this->z);
+			for (z = 0; z < this->z; z++) {
+				dst[z] += add[z];
+			}
+		}
+		if (y - radius - 1 >= 0) {
+			const uint16_t *sub = tmp + ((y - radius - 1) * this->z);
+			for (z = 0; z < this->z; z++) {
+				dst[z] -= sub[z];
+			}
+		}
+	}
+}
+
+
+/**
+ *  Compares the new generation in m_next against m_current brick by brick,
+ *  records the bricks that changed and brings the brick counts of m_next up
+ *  to date.
+ */
+void GameOfLife::diff_bricks() {
+	this->m_changed.clear();
+	diff_slab(0, this->m_current->bx, this->m_changed);
+}
 
+
+/**
+ *  diff_bricks() for the bricks in [bx0:bx1) along x, appends to changed.
+ */
+void GameOfLife::diff_slab(int bx0, int bx1, std::vector<int>& changed_bricks) {
+	const int plane = this->m_current->by * this->m_current->bz;
+	int b;
+	
+	for (b = bx0 * plane; b < bx1 * plane; b++) {
+		if (diff_brick(b)) changed_bricks.push_back(b);
+	}
+}
+
+
+/**
+ *  diff_bricks() for brick b alone.
+ * 
+ *  @return Whether any cell of the brick changed
+ */
+bool GameOfLife::diff_brick(int b) {
+	Grid *cur = this->m_current;
+	Grid *next = this->m_next;
+	const int x0 = (b / (cur->by * cur->bz)) << GRID_BRICK_SHIFT;
+	const int y0 = ((b / cur->bz) % cur->by) << GRID_BRICK_SHIFT;
+	const int z0 = (b % cur->bz) << GRID_BRICK_SHIFT;
+	const int x1 = std::min(x0 + GRID_BRICK, this->x);
+	const int y1 = std::min(y0 + GRID_BRICK, this->y);
+	const int len = std::min(z0 + GRID_BRICK, this->z) - z0;
+	bool changed = false;
+	int x, y;
+	
+	for (x = x0; x < x1 && !changed; x++) {
+		for (y = y0; y < y1 && !changed; y++) {
+			changed = memcmp(cur->m_cells + cur->index(x, y, z0), next->m_cells + next->index(x, y, z0), len) != 0;
+		}
+	}
+	
+	if (changed) {
+		next->update_brick(b);
+	} else {
+		next->m_bricks[b] = cur->m_bricks[b];
+	}
+	return changed;
+}
+
+
+/**
+ *  Brings the brick hashes and the combined state hash up to date after a
+ *  step and looks for a state seen up to CONWAY_PERIOD_MAX generations ago.
+ *  A repeat at distance p is only trusted once the next p generations have
+ *  repeated as well; their changes are logged along the way for replay().
+ */
+void GameOfLife::track() {
+	int p;
+	
+	for (int b : this->m_changed) {
+		uint64_t h = hash_brick(b);
+		this->m_hash ^= mix_brick(b, this->m_hashes[b]) ^ mix_brick(b, h);
+		this->m_hashes[b] = h;
+	}
+	this->m_age++;
+	
+	if (this->m_candidate) {
+		if (this->m_history[(this->m_age - this->m_candidate) % CONWAY_PERIOD_MAX] == this->m_hash) {
+			log_step();
+			if ((int) this->m_log.size() == this->m_candidate) {
+				this->m_period = this->m_candidate;
+				this->m_phase = 0;
+			}
+		} else {
+			this->m_candidate = 0;
+			this->m_log.clear();
+		}
+	}
+	
+	if (!this->m_candidate) {
+		for (p = 1; p <= CONWAY_PERIOD_MAX && p <= this->m_age; p++) {
+			if (this->m_history[(this->m_age - p) % CONWAY_PERIOD_MAX] == this->m_hash) {
+				this->m_candidate = p;
+				break;
+			}
+		}
+	}
+	
+	this->m_history[this->m_age % CONWAY_PERIOD_MAX] = this->m_hash;
+}
+
+
+/**
+ *  Forgets the state history and any period found, the next generations
+ *  are compared from scratch.
+ */
+void GameOfLife::reset_cycle() {
+	this->m_hash = 0;
+	this->m_age = 0;
+	this->m_period = 0;
+	this->m_candidate = 0;
+	this->m_phase = 0;
+	this->m_log.clear();
+	
+	for (size_t b = 0; b < this->m_hashes.size(); b++) {
+		this->m_hash ^= mix_brick((int) b, this->m_hashes[b]);
+	}
+	this->m_history[0] = this->m_hash;
+}
+
+
+/**
+ *  Records the bricks changed by the last step with their new cells.
+ */
+void GameOfLife::log_step() {
+	CycleStep step;
+	int lo[3], hi[3], i, j;
+	
+	step.bricks = this->m_changed;
+	for (int b : this->m_changed) {
+		brick_bounds(b, lo, hi);
+		for (i = lo[0]; i < hi[0]; i++) {
+			for (j = lo[1]; j < hi[1]; j++) {
+				const uint8_t *row = this->m_current->m_cells + this->m_current->index(i, j, lo[2]);
+				step.cells.insert(step.cells.end(), row, row + (hi[2] - lo[2]));
+			}
+		}
+	}
+	this->m_log.push_back(step);
+}
+
+
+/**
+ *  Writes the cells a logged step left in its bricks into a grid.
+ */
+void GameOfLife::apply_step(Grid *grid, const CycleStep &step) {
+	const uint8_t *cells = step.cells.data();
+	int lo[3], hi[3], i, j;
+	
+	for (int b : step.bricks) {
+		brick_bounds(b, lo, hi);
+		for (i = lo[0]; i < hi[0]; i++) {
+			for (j = lo[1]; j < hi[1]; j++) {
+				memcpy(grid->m_cells + grid->index(i, j, lo[2]), cells, hi[2] - lo[2]);
+				cells += hi[2] - lo[2];
+			}
+		}
+		grid->update_brick(b);
+	}
+}
+
+
+/**
+ *  Stands in for a step once a period is known. m_next holds the state one
+ *  generation back, so the logged changes into the current state and out
+ *  of it take it two generations forward.
+ */
+void GameOfLife::replay() {
+	const int p = this->m_period;
+	const CycleStep &prev = this->m_log[(this->m_phase + p - 1) % p];
+	const CycleStep &step = this->m_log[this->m_phase];
+	
+	apply_step(this->m_next, prev);
+	apply_step(this->m_next, step);
+	
 	Grid *temp = this->m_next;
 	m_next = m_current;
 	m_current = temp;
+	
+	this->m_changed = step.bricks;
+	this->m_phase = (this->m_phase + 1) % p;
 }
 
 
-// Private helper functions
+/**
+ *  Hashes the cells of brick b of m_current.
+ */
+uint64_t GameOfLife::hash_brick(int b) {
+	uint64_t h = 0x9E3779B97F4A7C15ull, v;
+	int lo[3], hi[3], i, j, k;
+	
+	brick_bounds(b, lo, hi);
+	for (i = lo[0]; i < hi[0]; i++) {
+		for (j = lo[1]; j < hi[1]; j++) {
+			const uint8_t *row = this->m_current->m_cells + this->m_current->index(i, j, lo[2]);
+			
+			for (k = 0; k < hi[2] - lo[2]; k += 8) {
+				v = 0;
+				memcpy(&v, row + k, std::min(8, hi[2] - lo[2] - k));
+				h = (h ^ v) * 0xBF58476D1CE4E5B9ull;
+				h ^= h >> 31;
+			}
+		}
+	}
+	return h;
+}
+
+
+/**
+ *  Scrambles a brick hash with the brick index, so the combined hash (the
+ *  xor of every brick) tells apart bricks that swapped places.
+ */
+uint64_t GameOfLife::mix_brick(int b, uint64_t h) {
+	h ^= (uint64_t) b * 0xD6E8FEB86659FD93ull;
+	h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+	h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+	return h ^ (h >> 31);
+}
+
+
+/**
+ *  Cell range [lo:hi) of brick b along each axis.
+ */
+void GameOfLife::brick_bounds(int b, int *lo, int *hi) {
+	const Grid *cur = this->m_current;
+	
+	lo[0] = (b / (cur->by * cur->bz)) << GRID_BRICK_SHIFT;
+	lo[1] = ((b / cur->bz) % cur->by) << GRID_BRICK_SHIFT;
+	lo[2] = (b % cur->bz) << GRID_BRICK_SHIFT;
+	hi[0] = std::min(lo[0] + GRID_BRICK, this->x);
+	hi[1] = std::min(lo[1] + GRID_BRICK, this->y);
+	hi[2] = std::min(lo[2] + GRID_BRICK, this->z);
+}
+
 
 int GameOfLife::count_neigbors(int x, int y, int z) {
 	int count = -this->m_current->m_cells[this->m_current->index(x, y, z)];
-	int i, j, k, in, jn, kn;
+	int i, j, k;
 	
-	for (i = x - 1; i <= x + 1; i++) {
-		for (j = y - 1; j <= y + 1; j++) {
-			for (k = z - 1; k <= z + 1; k++) {
-				wrap_bounds(i, j, k, &in, &jn, &kn);
-				count += this->m_current->m_cells[this->m_current->index(in, jn, kn)];
+	// Neighbors past the faces of the grid are dead
+	for (i = std::max(x - 1, 0); i <= std::min(x + 1, this->x - 1); i++) {
+		for (j = std::max(y - 1, 0); j <= std::min(y + 1, this->y - 1); j++) {
+			for (k = std::max(z - 1, 0); k <= std::min(z + 1, this->z - 1); k++) {
+				count += this->m_current->m_cells[this->m_current->index(i, j, k)];
 			}
 		}
 	}
@@ -87,10 +611,132 @@ int GameOfLife::count_neigbors(int x, int y, int z) {
 }
 
 
-void GameOfLife::wrap_bounds(int x0, int y0, int z0, int *x1, int *y1, int *z1) {
-	*x1 = x0 > 0 ? x0 < this->x ? x0 : this->x : 0;
-	*y1 = y0 > 0 ? y0 < this->y ? y0 : this->y : 0;
-	*z1 = z0 > 0 ? z0 < this->z ? z0 : this->z : 0;
+BitLife::BitLife(int x, int y, int z) {
+	this->m_current = new BitGrid(x, y, z);
+	this->m_next = new BitGrid(x, y, z);
+	this->x = x;
+	this->y = y;
+	this->z = z;
+}
+
+
+BitLife::~BitLife() {
+	delete this->m_current;
+	delete this->m_next;
+	this->x = 0;
+	this->y = 0;
+	this->z = 0;
+}
+
+
+void BitLife::populate(int percent) {
+	int x, y, z;
+	
+	for (x = 0; x < this->x; x++) {
+		for (y = 0; y < this->y; y++) {
+			for (z = 0; z < this->z; z++) {
+				this->m_current->set(x, y, z, (rand() % 100) < percent);
+			}
+		}
+	}
 }
 
 
+void BitLife::step() {
+	static const uint64_t none[1] = { 0 };
+	const int words = this->m_current->words;
+	const uint64_t *rows[9];
+	uint64_t t[5], s0, s1, lo, mid, hi, cur, survive, birth;
+	int x, y, w, r, k;
+	
+	for (x = 0; x < this->x; x++) {
+		for (y = 0; y < this->y; y++) {
+			// The 3x3 block of rows around this one, missing rows are dead
+			for (r = 0; r < 9; r++) {
+				int nx = x + (r / 3) - 1;
+				int ny = y + (r % 3) - 1;
+				rows[r] = (nx < 0 || ny < 0 || nx >= this->x || ny >= this->y) ? none : this->m_current->row(nx, ny);
+			}
+			uint64_t *out = this->m_next->row(x, y);
+			
+			for (w = 0; w < words; w++) {
+				// Bit-sliced 5 bit counter, bit i of t[j] is bit j of the
+				// population of the 3x3x3 block around cell i (self included)
+				t[0] = t[1] = t[2] = t[3] = t[4] = 0;
+				
+				for (r = 0; r < 9; r++) {
+					const uint64_t *row = rows[r];
+					if (row == none) continue;
+					
+					mid = row[w];
+					lo = (mid << 1) | (w > 0 ? row[w - 1] >> 63 : 0);
+					hi = (mid >> 1) | (w + 1 < words ? row[w + 1] << 63 : 0);
+					
+					// Full adder over the three cells along z
+					s0 = lo ^ mid ^ hi;
+					s1 = (lo & mid) | (hi & (lo ^ mid));
+					
+					add2(t, s0, s1);
+				}
+				
+				// The rule as boolean logic over the counter bits
+				cur = rows[4][w];
+				survive = 0;
+				birth = 0;
+				for (k = CONWAY_SURVIVE_LOW; k <= CONWAY_SURVIVE_HIGH; k++) {
+					survive |= equals(t, k + 1);
+				}
+				for (k = CONWAY_BIRTH_LOW; k <= CONWAY_BIRTH_HIGH; k++) {
+					birth |= equals(t, k);
+				}
+				
+				out[w] = ((cur & survive) | (~cur & birth)) & this->m_next->mask(w);
+			}
+		}
+	}
+	
+	BitGrid *temp = this->m_next;
+	m_next = m_current;
+	m_current = temp;
+}
+
+
+// Private helper functions
+
+/**
+ *  Adds the 2 bit numbers (s0, s1) to the bit-sliced counter t, one lane per
+ *  bit. The counter never exceeds 27, so the carry out of t[4] is dropped.
+ */
+inline void BitLife::add2(uint64_t *t, uint64_t s0, uint64_t s1) {
+	uint64_t c, n;
+	
+	c = t[0] & s0;
+	t[0] ^= s0;
+	
+	n = (t[1] & s1) | (c & (t[1] ^ s1));
+	t[1] ^= s1 ^ c;
+	c = n;
+	
+	n = t[2] & c;
+	t[2] ^= c;
+	c = n;
+	
+	n = t[3] & c;
+	t[3] ^= c;
+	
+	t[4] ^= n;
+}
+
+
+/**
+ *  @return Mask of the lanes where the bit-sliced counter t equals k
+ */
+inline uint64_t BitLife::equals(const uint64_t *t, int k) {
+	uint64_t m = ~(uint64_t) 0;
+	int j;
+	
+	for (j = 0; j < 5; j++) {
+		m &= ((k >> j) & 1) ? t[j] : ~t[j];
+	}
+	return m;
+}
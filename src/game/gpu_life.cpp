@@ -0,0 +1,137 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#include "gpu_life.h"
+#include "automaton.h"
+#include "conway.h"
+
+#include <algorithm>
+
+
+GpuLife::GpuLife(int x, int y, int z) {
+	this->m_buffers[0] = 0;
+	this->m_buffers[1] = 0;
+	this->m_current = 0;
+
+	// Two 32 bit words per 64 bit BitGrid word, so rows match BitGrid
+	this->m_words = ((z + 63) >> 6) * 2;
+	this->m_bytes = (size_t) x * y * this->m_words * sizeof(uint32_t);
+	this->x = x;
+	this->y = y;
+	this->z = z;
+}
+
+
+GpuLife::~GpuLife() {
+	if (this->m_buffers[0]) glDeleteBuffers(2, this->m_buffers);
+	this->x = 0;
+	this->y = 0;
+	this->z = 0;
+}
+
+
+int GpuLife::init() {
+	int code, i;
+
+	code = this->m_shader.load_file(COMPUTE, "life.comp");
+	if (code != CODE_SUCCESS) return code;
+	code = this->m_shader.compile();
+	if (code != CODE_SUCCESS) return code;
+
+	glGenBuffers(2, this->m_buffers);
+	for (i = 0; i < 2; i++) {
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->m_buffers[i]);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, this->m_bytes, NULL, GL_DYNAMIC_COPY);
+		glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	this->m_current = 0;
+
+	return CODE_SUCCESS;
+}
+
+
+void GpuLife::load(BitGrid *grid) {
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->m_buffers[this->m_current]);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, this->m_bytes, grid->m_words);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+
+void GpuLife::load(Grid *grid) {
+	BitGrid bits(this->x, this->y, this->z);
+
+	bits.pack(grid);
+	load(&bits);
+}
+
+
+void GpuLife::store(BitGrid *grid) {
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->m_buffers[this->m_current]);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, this->m_bytes, grid->m_words);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+
+void GpuLife::store(Grid *grid) {
+	BitGrid bits(this->x, this->y, this->z);
+
+	store(&bits);
+	bits.unpack(grid);
+}
+
+
+void GpuLife::step(int generations) {
+	const long total = (long) this->x * this->y * this->m_words;
+	const long groups = (total + GPU_LIFE_GROUP - 1) / GPU_LIFE_GROUP;
+	const GLuint groups_x = (GLuint) std::min(groups, (long) GPU_LIFE_MAX_GROUPS);
+	const GLuint groups_y = (GLuint) ((groups + groups_x - 1) / groups_x);
+	int g;
+
+	if (total == 0) return;
+
+	this->m_shader.bind();
+	this->m_shader.uniform_int("size_x", this->x);
+	this->m_shader.uniform_int("size_y", this->y);
+	this->m_shader.uniform_int("size_z", this->z);
+	this->m_shader.uniform_int("words", this->m_words);
+	this->m_shader.uniform_int("birth", (int) automaton_range(CONWAY_BIRTH_LOW, CONWAY_BIRTH_HIGH));
+	this->m_shader.uniform_int("survive", (int) automaton_range(CONWAY_SURVIVE_LOW, CONWAY_SURVIVE_HIGH));
+
+	for (g = 0; g < generations; g++) {
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, this->m_buffers[this->m_current]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, this->m_buffers[this->m_current ^ 1]);
+		glDispatchCompute(groups_x, groups_y, 1);
+
+		// The next pass reads what this one wrote
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		this->m_current ^= 1;
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+	this->m_shader.unbind();
+}
+
+
+GLuint GpuLife::buffer() const {
+	return this->m_buffers[this->m_current];
+}
+
+
+int GpuLife::words() const {
+	return this->m_words;
+}
@@ -0,0 +1,323 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#include "gpu_mcubes.h"
+#include "tables.h"
+
+#include <stddef.h>
+#include <algorithm>
+
+
+// Work groups per dispatch dimension every GL 4.3 implementation supports
+#define GPU_MC_MAX_GROUPS   (65535)
+
+// Cell sources of mcubes.comp
+#define SOURCE_VOLUME       (0)
+#define SOURCE_BITS         (1)
+
+
+/**
+ *  Lookup tables as mcubes.comp declares them, std430 packs these tightly.
+ */
+struct GpuTables {
+	int32_t tri_table[256 * 16];
+	int32_t tri_count[256];
+	float edge_offset[12 * 3];
+};
+
+
+/**
+ *  What mcubes.comp writes to the command buffer.
+ */
+struct GpuCommand {
+	uint32_t count;
+	uint32_t instance_count;
+	uint32_t first;
+	uint32_t base_instance;
+	uint32_t total;
+};
+
+
+static void dispatch(int64_t groups);
+
+
+GpuMarchingCubes::GpuMarchingCubes(int x, int y, int z, int64_t capacity) {
+	this->m_volume = 0;
+	this->m_tables = 0;
+	this->m_triangles = 0;
+	this->m_vertices = 0;
+	this->m_command = 0;
+	this->m_vao = 0;
+	this->m_cells = (x > 1 && y > 1 && z > 1) ? (int64_t) (x - 1) * (y - 1) * (z - 1) : 0;
+	this->m_capacity = std::min(std::max(capacity, (int64_t) 0), (int64_t) GPU_MC_CAPACITY_MAX);
+	this->x = x;
+	this->y = y;
+	this->z = z;
+}
+
+
+GpuMarchingCubes::~GpuMarchingCubes() {
+	if (this->m_volume) glDeleteTextures(1, &this->m_volume);
+	if (this->m_tables) glDeleteBuffers(1, &this->m_tables);
+	if (this->m_triangles) glDeleteBuffers(1, &this->m_triangles);
+	if (this->m_vertices) glDeleteBuffers(1, &this->m_vertices);
+	if (this->m_command) glDeleteBuffers(1, &this->m_command);
+	if (this->m_vao) glDeleteVertexArrays(1, &this->m_vao);
+	if (!this->m_sums.empty()) glDeleteBuffers((GLsizei) this->m_sums.size(), this->m_sums.data());
+	this->x = 0;
+	this->y = 0;
+	this->z = 0;
+}
+
+
+int GpuMarchingCubes::init() {
+	GpuTables tables;
+	GpuCommand command = {};
+	int64_t n;
+	int code, i, j;
+
+	code = this->m_mesher.load_file(COMPUTE, "mcubes.comp");
+	if (code != CODE_SUCCESS) return code;
+	code = this->m_mesher.compile();
+	if (code != CODE_SUCCESS) return code;
+	code = this->m_scan.load_file(COMPUTE, "scan.comp");
+	if (code != CODE_SUCCESS) return code;
+	code = this->m_scan.compile();
+	if (code != CODE_SUCCESS) return code;
+
+	for (i = 0; i < 256; i++) {
+		for (j = 0; j < 16; j++) {
+			tables.tri_table[(i * 16) + j] = MC_TRI_TABLE[i][j];
+		}
+		tables.tri_count[i] = MC_TRI_COUNT[i];
+	}
+	for (i = 0; i < 12; i++) {
+		for (j = 0; j < 3; j++) {
+			tables.edge_offset[(i * 3) + j] = MC_OFFSETS[i][j];
+		}
+	}
+
+	glGenBuffers(1, &this->m_tables);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->m_tables);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(tables), &tables, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &this->m_triangles);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->m_triangles);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, std::max(this->m_cells, (int64_t) 1) * sizeof(uint32_t), NULL, GL_DYNAMIC_COPY);
+
+	// One buffer of block totals per level of the prefix sum, down to a
+	// single block
+	for (n = this->m_cells; n > 0; ) {
+		GLuint sums;
+
+		n = (n + GPU_MC_SCAN_BLOCK - 1) / GPU_MC_SCAN_BLOCK;
+		glGenBuffers(1, &sums);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, sums);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, n * sizeof(uint32_t), NULL, GL_DYNAMIC_COPY);
+		this->m_sums.push_back(sums);
+		if (n == 1) break;
+	}
+
+	glGenBuffers(1, &this->m_vertices);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->m_vertices);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, std::max(this->m_capacity, (int64_t) 1) * 3 * sizeof(Vertex), NULL, GL_DYNAMIC_COPY);
+
+	glGenBuffers(1, &this->m_command);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->m_command);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(command), &command, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glGenTextures(1, &this->m_volume);
+	glBindTexture(GL_TEXTURE_3D, this->m_volume);
+	glTexStorage3D(GL_TEXTURE_3D, 1, GL_R8UI, this->z, this->y, this->x);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_3D, 0);
+
+	// Same attributes as mesh_create(), fed from the vertex buffer
+	glGenVertexArrays(1, &this->m_vao);
+	glBindVertexArray(this->m_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, this->m_vertices);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position)); // Position
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal)); // Normal
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texture)); // Texture
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return CODE_SUCCESS;
+}
+
+
+void GpuMarchingCubes::load(Grid *grid) {
+	glBindTexture(GL_TEXTURE_3D, this->m_volume);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	// z runs fastest in a Grid, so it is the width of the texture
+	glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, this->z, this->y, this->x, GL_RED_INTEGER, GL_UNSIGNED_BYTE, grid->m_cells);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+
+void GpuMarchingCubes::generate() {
+	run(SOURCE_VOLUME, 0, 0);
+}
+
+
+void GpuMarchingCubes::generate(GpuLife *life) {
+	run(SOURCE_BITS, life->buffer(), life->words());
+}
+
+
+void GpuMarchingCubes::render() {
+	glBindVertexArray(this->m_vao);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->m_command);
+	glDrawArraysIndirect(GL_TRIANGLES, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+
+int64_t GpuMarchingCubes::triangles() {
+	GpuCommand command;
+
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->m_command);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(command), &command);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	return command.total;
+}
+
+
+void GpuMarchingCubes::store(std::vector<Vertex> &vertices) {
+	int64_t n = std::min(triangles(), this->m_capacity) * 3;
+
+	vertices.resize(n);
+	if (n == 0) return;
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->m_vertices);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, n * sizeof(Vertex), vertices.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+
+GLuint GpuMarchingCubes::buffer() const {
+	return this->m_vertices;
+}
+
+
+int64_t GpuMarchingCubes::capacity() const {
+	return this->m_capacity;
+}
+
+
+// Private helper functions
+
+void GpuMarchingCubes::run(int source, GLuint bits, int words) {
+	const int64_t groups = (this->m_cells + GPU_MC_GROUP - 1) / GPU_MC_GROUP;
+	GpuCommand command = {};
+
+	// Nothing to dispatch, no cell is left to write the command
+	if (this->m_cells == 0) {
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->m_command);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(command), &command);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		return;
+	}
+
+	this->m_mesher.bind();
+	this->m_mesher.uniform_int("volume", 0);
+	this->m_mesher.uniform_int("source", source);
+	this->m_mesher.uniform_int("words", words);
+	this->m_mesher.uniform_int("size_x", this->x);
+	this->m_mesher.uniform_int("size_y", this->y);
+	this->m_mesher.uniform_int("size_z", this->z);
+	this->m_mesher.uniform_int("capacity", (int) this->m_capacity);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_3D, this->m_volume);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, this->m_tables);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, this->m_triangles);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, this->m_vertices);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, this->m_command);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, bits);
+
+	// Count the triangles of every cell
+	this->m_mesher.uniform_int("pass", 0);
+	dispatch(groups);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	scan(this->m_triangles, this->m_cells, 0);
+
+	// The scan bound its own buffers
+	this->m_mesher.bind();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, this->m_tables);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, this->m_triangles);
+	this->m_mesher.uniform_int("pass", 1);
+	dispatch(groups);
+
+	// The vertices are drawn and the command read by the next draw
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+	for (int i = 0; i < 5; i++) {
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, 0);
+	}
+	glBindTexture(GL_TEXTURE_3D, 0);
+	this->m_mesher.unbind();
+}
+
+
+/**
+ *  Exclusive prefix sum of n uints in place. Blocks are scanned on their
+ *  own, then their totals are scanned one level up and added back.
+ */
+void GpuMarchingCubes::scan(GLuint data, int64_t n, int level) {
+	const int64_t blocks = (n + GPU_MC_SCAN_BLOCK - 1) / GPU_MC_SCAN_BLOCK;
+	GLuint sums = this->m_sums[level];
+
+	this->m_scan.bind();
+	this->m_scan.uniform_int("n", (int) n);
+	this->m_scan.uniform_int("pass", 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, data);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, sums);
+	dispatch(blocks);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	if (blocks == 1) return;
+
+	scan(sums, blocks, level + 1);
+
+	this->m_scan.bind();
+	this->m_scan.uniform_int("n", (int) n);
+	this->m_scan.uniform_int("pass", 1);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, data);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, sums);
+	dispatch(blocks);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+
+/**
+ *  Dispatches a number of work groups, folded into a second dimension
+ *  past what one dimension holds.
+ */
+static void dispatch(int64_t groups) {
+	const GLuint groups_x = (GLuint) std::min(groups, (int64_t) GPU_MC_MAX_GROUPS);
+	const GLuint groups_y = (GLuint) ((groups + groups_x - 1) / groups_x);
+
+	glDispatchCompute(groups_x, groups_y, 1);
+}
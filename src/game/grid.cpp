@@ -15,25 +15,307 @@
 */
 #include "grid.h"
 
+#include <limits.h>
+#include <algorithm>
 
-Grid::Grid(int x, int y, int z) {
-    this->m_cells = new uint8_t[x * y * z];
+#include "cpu.h"
+
+
+Grid::Grid(int x, int y, int z) : Grid(x, y, z, new uint8_t[fits(x, y, z) ? (size_t) x * y * z : 0]) {
+    this->m_owned = true;
+}
+
+
+Grid::Grid(int x, int y, int z, uint8_t *cells) {
+    int n;
+
+    if (!fits(x, y, z)) x = y = z = 0;
+
+    this->m_cells = cells;
+    this->m_owned = false;
     this->x = x;
     this->y = y;
     this->z = z;
+
+    this->bx = (x + GRID_BRICK - 1) >> GRID_BRICK_SHIFT;
+    this->by = (y + GRID_BRICK - 1) >> GRID_BRICK_SHIFT;
+    this->bz = (z + GRID_BRICK - 1) >> GRID_BRICK_SHIFT;
+    n = this->bx * this->by * this->bz;
+    this->m_bricks = new uint16_t[n];
+    std::fill(this->m_bricks, this->m_bricks + n, (uint16_t) GRID_BRICK_UNKNOWN);
 }
 
 
 Grid::~Grid() {
-    delete[] this->m_cells;
+    if (this->m_owned) delete[] this->m_cells;
+    delete[] this->m_bricks;
+    this->x = 0;
+    this->y = 0;
+    this->z = 0;
+}
+
+
+bool Grid::fits(int x, int y, int z) {
+    uint64_t plane, bricks;
+
+    if (x < 0 || y < 0 || z < 0) return false;
+
+    plane = (uint64_t) y * z;
+    if (plane > INT_MAX) return false;
+
+    // At most 2^28 bricks along x times the bricks of a plane, no overflow
+    bricks = (((uint64_t) x + GRID_BRICK - 1) >> GRID_BRICK_SHIFT) *
+             (((uint64_t) y + GRID_BRICK - 1) >> GRID_BRICK_SHIFT) *
+             (((uint64_t) z + GRID_BRICK - 1) >> GRID_BRICK_SHIFT);
+    return bricks <= INT_MAX && (plane == 0 || (uint64_t) x <= PTRDIFF_MAX / plane);
+}
+
+
+size_t Grid::index(int x, int y, int z) {
+	return ((size_t) x * this->y * this->z) + ((size_t) y * this->z) + z;
+}
+
+
+void Grid::set(int x, int y, int z, uint8_t v) {
+    size_t c = index(x, y, z);
+    int b = brick(x, y, z);
+    bool was = this->m_cells[c] != 0;
+
+    this->m_cells[c] = v;
+    if (this->m_bricks[b] == GRID_BRICK_UNKNOWN || was == (v != 0)) return;
+    this->m_bricks[b] += was ? -1 : 1;
+}
+
+
+void Grid::update_bricks() {
+    int x, y, z, z1;
+    int b, n;
+    const uint8_t *row;
+
+    std::fill(this->m_bricks, this->m_bricks + (this->bx * this->by * this->bz), (uint16_t) 0);
+
+    for (x = 0; x < this->x; x++) {
+        for (y = 0; y < this->y; y++) {
+            row = this->m_cells + index(x, y, 0);
+            b = brick(x, y, 0);
+
+            // One brick per run of GRID_BRICK cells along the row
+            for (z = 0; z < this->z; b++) {
+                z1 = std::min(z + GRID_BRICK, this->z);
+                for (n = 0; z < z1; z++) {
+                    n += row[z] != 0;
+                }
+                this->m_bricks[b] += n;
+            }
+        }
+    }
+}
+
+
+void Grid::update_brick(int b) {
+    int x0 = (b / (this->by * this->bz)) << GRID_BRICK_SHIFT;
+    int y0 = ((b / this->bz) % this->by) << GRID_BRICK_SHIFT;
+    int z0 = (b % this->bz) << GRID_BRICK_SHIFT;
+    int x1 = std::min(x0 + GRID_BRICK, this->x);
+    int y1 = std::min(y0 + GRID_BRICK, this->y);
+    int z1 = std::min(z0 + GRID_BRICK, this->z);
+    int x, y, z, n = 0;
+
+    for (x = x0; x < x1; x++) {
+        for (y = y0; y < y1; y++) {
+            const uint8_t *row = this->m_cells + index(x, y, 0);
+            for (z = z0; z < z1; z++) {
+                n += row[z] != 0;
+            }
+        }
+    }
+    this->m_bricks[b] = (uint16_t) n;
+}
+
+
+int Grid::brick(int x, int y, int z) {
+    return ((x >> GRID_BRICK_SHIFT) * this->by * this->bz) +
+           ((y >> GRID_BRICK_SHIFT) * this->bz) +
+           (z >> GRID_BRICK_SHIFT);
+}
+
+
+BrickState Grid::brick_state(int b) {
+    int bx = b / (this->by * this->bz);
+    int by = (b / this->bz) % this->by;
+    int bz = b % this->bz;
+    int volume;
+
+    if (this->m_bricks[b] == GRID_BRICK_UNKNOWN) return BRICK_MIXED;
+    if (this->m_bricks[b] == 0) return BRICK_EMPTY;
+
+    // Bricks on the far faces may be cut short
+    volume = (std::min((bx + 1) << GRID_BRICK_SHIFT, this->x) - (bx << GRID_BRICK_SHIFT)) *
+             (std::min((by + 1) << GRID_BRICK_SHIFT, this->y) - (by << GRID_BRICK_SHIFT)) *
+             (std::min((bz + 1) << GRID_BRICK_SHIFT, this->z) - (bz << GRID_BRICK_SHIFT));
+    return this->m_bricks[b] == volume ? BRICK_FULL : BRICK_MIXED;
+}
+
+
+BrickState Grid::region_state(int x0, int y0, int z0, int x1, int y1, int z1) {
+    BrickState state, first = BRICK_MIXED;
+    int i, j, k;
+    bool any = false;
+
+    x0 = std::max(x0, 0); x1 = std::min(x1, this->x);
+    y0 = std::max(y0, 0); y1 = std::min(y1, this->y);
+    z0 = std::max(z0, 0); z1 = std::min(z1, this->z);
+    if (x0 >= x1 || y0 >= y1 || z0 >= z1) return BRICK_EMPTY;
+
+    for (i = x0 >> GRID_BRICK_SHIFT; i <= (x1 - 1) >> GRID_BRICK_SHIFT; i++) {
+        for (j = y0 >> GRID_BRICK_SHIFT; j <= (y1 - 1) >> GRID_BRICK_SHIFT; j++) {
+            for (k = z0 >> GRID_BRICK_SHIFT; k <= (z1 - 1) >> GRID_BRICK_SHIFT; k++) {
+                state = brick_state((i * this->by * this->bz) + (j * this->bz) + k);
+                if (state == BRICK_MIXED) return BRICK_MIXED;
+                if (any && state != first) return BRICK_MIXED;
+                first = state;
+                any = true;
+            }
+        }
+    }
+    return first;
+}
+
+
+long Grid::count() {
+    long n = 0;
+    int b;
+
+    for (b = 0; b < this->bx * this->by * this->bz; b++) {
+        if (this->m_bricks[b] == GRID_BRICK_UNKNOWN) update_brick(b);
+        n += this->m_bricks[b];
+    }
+    return n;
+}
+
+
+DensityGrid::DensityGrid(int x, int y, int z) {
+    if (!Grid::fits(x, y, z)) x = y = z = 0;
+
+    this->m_values = new float[(size_t) x * y * z];
+    this->x = x;
+    this->y = y;
+    this->z = z;
+}
+
+
+DensityGrid::~DensityGrid() {
+    delete[] this->m_values;
+    this->x = 0;
+    this->y = 0;
+    this->z = 0;
+}
+
+
+size_t DensityGrid::index(int x, int y, int z) {
+	return ((size_t) x * this->y * this->z) + ((size_t) y * this->z) + z;
+}
+
+
+BitGrid::BitGrid(int x, int y, int z) {
+    this->x = x;
+    this->y = y;
+    this->z = z;
+    this->words = (z + 63) >> 6;
+    this->m_words = new uint64_t[(size_t) x * y * this->words]();
+}
+
+
+BitGrid::~BitGrid() {
+    delete[] this->m_words;
     this->x = 0;
     this->y = 0;
     this->z = 0;
 }
 
 
-int Grid::index(int x, int y, int z) {
-	return (x * this->y * this->z) + (y * this->z) + z;
+uint64_t* BitGrid::row(int x, int y) {
+    return this->m_words + ((((size_t) x * this->y) + y) * this->words);
+}
+
+
+bool BitGrid::get(int x, int y, int z) {
+    return (row(x, y)[z >> 6] >> (z & 63)) & 1;
+}
+
+
+void BitGrid::set(int x, int y, int z, bool v) {
+    uint64_t *w = row(x, y) + (z >> 6);
+    uint64_t bit = (uint64_t) 1 << (z & 63);
+
+    *w = v ? (*w | bit) : (*w & ~bit);
+}
+
+
+uint64_t BitGrid::mask(int w) {
+    int left = this->z - (w << 6);
+    return left >= 64 ? ~(uint64_t) 0 : (((uint64_t) 1 << left) - 1);
+}
+
+
+long BitGrid::count_row(int x, int y) {
+    const uint64_t *r = row(x, y);
+    long n = 0;
+    int w;
+
+    for (w = 0; w < this->words; w++) {
+        n += cpu_popcount(r[w]);
+    }
+    return n;
+}
+
+
+long BitGrid::count() {
+    size_t i, n = (size_t) this->x * this->y * this->words;
+    long total = 0;
+
+    for (i = 0; i < n; i++) {
+        total += cpu_popcount(this->m_words[i]);
+    }
+    return total;
+}
+
+
+void BitGrid::pack(Grid* grid) {
+    int x, y, z, w;
+    uint64_t bits;
+
+    for (x = 0; x < this->x; x++) {
+        for (y = 0; y < this->y; y++) {
+            const uint8_t *cells = grid->m_cells + grid->index(x, y, 0);
+            uint64_t *r = row(x, y);
+
+            for (w = 0; w < this->words; w++) {
+                bits = 0;
+                for (z = w << 6; z < std::min((w + 1) << 6, this->z); z++) {
+                    bits |= (uint64_t) (cells[z] != 0) << (z & 63);
+                }
+                r[w] = bits;
+            }
+        }
+    }
+}
+
+
+void BitGrid::unpack(Grid* grid) {
+    int x, y, z;
+
+    for (x = 0; x < this->x; x++) {
+        for (y = 0; y < this->y; y++) {
+            uint8_t *cells = grid->m_cells + grid->index(x, y, 0);
+            const uint64_t *r = row(x, y);
+
+            for (z = 0; z < this->z; z++) {
+                cells[z] = (r[z >> 6] >> (z & 63)) & 1;
+            }
+        }
+    }
+    grid->update_bricks();
 }
 
 
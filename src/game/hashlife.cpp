@@ -0,0 +1,405 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#include "hashlife.h"
+#include "conway.h"
+
+#include <string.h>
+#include <algorithm>
+
+
+HashLife::HashLife() {
+	memset(&this->m_dead, 0, sizeof(HashNode));
+	memset(&this->m_alive, 0, sizeof(HashNode));
+	this->m_alive.population = 1;
+	this->m_empty.push_back(&this->m_dead);
+
+	this->m_root = empty(3);
+	this->m_ox = 0;
+	this->m_oy = 0;
+	this->m_oz = 0;
+	this->m_generation = 0;
+}
+
+
+HashLife::~HashLife() {
+	for (HashNode *n : this->m_nodes) {
+		delete n;
+	}
+	this->m_nodes.clear();
+	this->m_root = nullptr;
+}
+
+
+void HashLife::load(Grid *grid) {
+	int level = 3;
+
+	while ((1 << level) < std::max(grid->x, std::max(grid->y, grid->z))) {
+		level++;
+	}
+
+	this->m_root = build(grid, level, 0, 0, 0);
+	this->m_ox = 0;
+	this->m_oy = 0;
+	this->m_oz = 0;
+	this->m_generation = 0;
+}
+
+
+void HashLife::store(Grid *grid, int64_t x0, int64_t y0, int64_t z0) {
+	memset(grid->m_cells, 0, (size_t) grid->x * grid->y * grid->z);
+	write(this->m_root, grid, this->m_ox - x0, this->m_oy - y0, this->m_oz - z0);
+	grid->update_bricks();
+}
+
+
+void HashLife::advance(uint64_t generations) {
+	int j;
+
+	for (j = 0; generations; j++, generations >>= 1) {
+		if (generations & 1) step(j);
+	}
+
+	if (this->m_nodes.size() > HASHLIFE_NODE_LIMIT) collect();
+}
+
+
+uint64_t HashLife::generation() const {
+	return this->m_generation;
+}
+
+
+uint64_t HashLife::population() const {
+	return this->m_root->population;
+}
+
+
+size_t HashLife::nodes() const {
+	return this->m_nodes.size();
+}
+
+
+// Private helper functions
+
+size_t HashLife::NodeHash::operator()(const HashNode *n) const {
+	size_t h = 0;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		h = (h * 0x9E3779B97F4A7C15ull) + ((uintptr_t) n->child[i] >> 4);
+	}
+	return h ^ (h >> 29);
+}
+
+
+bool HashLife::NodeEqual::operator()(const HashNode *a, const HashNode *b) const {
+	return memcmp(a->child, b->child, sizeof(a->child)) == 0;
+}
+
+
+/**
+ *  Returns the one node made of these 8 octants, creating it if needed.
+ */
+HashNode* HashLife::join(HashNode **child) {
+	HashNode key;
+	int i;
+
+	memcpy(key.child, child, sizeof(key.child));
+	auto it = this->m_nodes.find(&key);
+	if (it != this->m_nodes.end()) return *it;
+
+	HashNode *n = new HashNode;
+	memcpy(n->child, child, sizeof(n->child));
+	n->result = nullptr;
+	n->result_step = -1;
+	n->population = 0;
+	n->level = child[0]->level + 1;
+	n->marked = false;
+	for (i = 0; i < 8; i++) {
+		n->population += child[i]->population;
+	}
+
+	this->m_nodes.insert(n);
+	return n;
+}
+
+
+HashNode* HashLife::empty(int level) {
+	HashNode *child[8];
+
+	while ((int) this->m_empty.size() <= level) {
+		std::fill(child, child + 8, this->m_empty.back());
+		this->m_empty.push_back(join(child));
+	}
+	return this->m_empty[level];
+}
+
+
+/**
+ *  Returns the node at (x, y, z) of the 4x4x4 grandchildren of n.
+ */
+HashNode* HashLife::grandchild(HashNode *n, int x, int y, int z) {
+	HashNode *c = n->child[((x >> 1) << 2) | ((y >> 1) << 1) | (z >> 1)];
+	return c->child[((x & 1) << 2) | ((y & 1) << 1) | (z & 1)];
+}
+
+
+/**
+ *  Returns the cube half the size of n sharing its centre.
+ */
+HashNode* HashLife::centre(HashNode *n) {
+	HashNode *child[8];
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		child[i] = grandchild(n, 1 + (i >> 2), 1 + ((i >> 1) & 1), 1 + (i & 1));
+	}
+	return join(child);
+}
+
+
+/**
+ *  Returns the cube twice the size of n with n at its centre.
+ */
+HashNode* HashLife::expand(HashNode *n) {
+	HashNode *child[8], *octant[8];
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		std::fill(octant, octant + 8, empty(n->level - 1));
+		octant[7 - i] = n->child[i];
+		child[i] = join(octant);
+	}
+	return join(child);
+}
+
+
+/**
+ *  Returns the centre of n, a node of level k, 2^step generations later.
+ *  Steps up to k - 2 are possible. Calls on the same node keep reusing the
+ *  last result for as long as the step does not change.
+ */
+HashNode* HashLife::result(HashNode *n, int step) {
+	HashNode *sub[27], *child[8], *octant[8];
+	int i, j, k, a;
+
+	if (n->population == 0) return empty(n->level - 1);
+	if (n->result && n->result_step == step) return n->result;
+
+	if (n->level == 2) {
+		n->result = base(n);
+		n->result_step = step;
+		return n->result;
+	}
+
+	// 27 overlapping cubes of level k - 1 over the 4x4x4 grandchildren. For
+	// the full step they advance half the time here, otherwise they are
+	// only cropped and the whole step happens below.
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < 3; j++) {
+			for (k = 0; k < 3; k++) {
+				for (a = 0; a < 8; a++) {
+					octant[a] = grandchild(n, i + (a >> 2), j + ((a >> 1) & 1), k + (a & 1));
+				}
+				HashNode *s = join(octant);
+				sub[(i * 9) + (j * 3) + k] = (step == n->level - 2) ? result(s, step - 1) : centre(s);
+			}
+		}
+	}
+
+	// Each octant of the result advances the rest of the way from the 8
+	// cubes above it
+	for (i = 0; i < 8; i++) {
+		int x = i >> 2, y = (i >> 1) & 1, z = i & 1;
+
+		for (a = 0; a < 8; a++) {
+			octant[a] = sub[((x + (a >> 2)) * 9) + ((y + ((a >> 1) & 1)) * 3) + z + (a & 1)];
+		}
+		child[i] = result(join(octant), std::min(step, n->level - 3));
+	}
+
+	n->result = join(child);
+	n->result_step = step;
+	return n->result;
+}
+
+
+/**
+ *  Runs the rule directly on the 4x4x4 cells of a level 2 node and returns
+ *  its centre one generation later.
+ */
+HashNode* HashLife::base(HashNode *n) {
+	HashNode *child[8];
+	uint8_t cells[4][4][4];
+	int x, y, z, i, j, k, count;
+
+	for (x = 0; x < 4; x++) {
+		for (y = 0; y < 4; y++) {
+			for (z = 0; z < 4; z++) {
+				cells[x][y][z] = (uint8_t) grandchild(n, x, y, z)->population;
+			}
+		}
+	}
+
+	for (i = 0; i < 8; i++) {
+		x = 1 + (i >> 2);
+		y = 1 + ((i >> 1) & 1);
+		z = 1 + (i & 1);
+		count = -cells[x][y][z];
+
+		for (j = -1; j <= 1; j++) {
+			for (k = -1; k <= 1; k++) {
+				count += cells[x + j][y + k][z - 1] + cells[x + j][y + k][z] + cells[x + j][y + k][z + 1];
+			}
+		}
+
+		bool alive = cells[x][y][z] ?
+			(count >= CONWAY_SURVIVE_LOW && count <= CONWAY_SURVIVE_HIGH) :
+			(count >= CONWAY_BIRTH_LOW && count <= CONWAY_BIRTH_HIGH);
+		child[i] = alive ? &this->m_alive : &this->m_dead;
+	}
+	return join(child);
+}
+
+
+/**
+ *  Builds the node of the given level for the cube of grid cells at
+ *  (x, y, z), cells past the grid are dead.
+ */
+HashNode* HashLife::build(Grid *grid, int level, int x, int y, int z) {
+	HashNode *child[8];
+	int half, i;
+
+	if (grid->region_state(x, y, z, x + (1 << level), y + (1 << level), z + (1 << level)) == BRICK_EMPTY) {
+		return empty(level);
+	}
+	if (level == 0) {
+		return grid->m_cells[grid->index(x, y, z)] ? &this->m_alive : &this->m_dead;
+	}
+
+	half = 1 << (level - 1);
+	for (i = 0; i < 8; i++) {
+		child[i] = build(grid, level - 1, x + ((i >> 2) * half), y + (((i >> 1) & 1) * half), z + ((i & 1) * half));
+	}
+	return join(child);
+}
+
+
+/**
+ *  Sets the living cells of n, whose corner is at grid cell (x, y, z), in
+ *  the grid.
+ */
+void HashLife::write(HashNode *n, Grid *grid, int64_t x, int64_t y, int64_t z) {
+	const int64_t size = (int64_t) 1 << n->level;
+	int64_t half;
+	int i;
+
+	if (n->population == 0) return;
+	if (x >= grid->x || y >= grid->y || z >= grid->z) return;
+	if (x + size <= 0 || y + size <= 0 || z + size <= 0) return;
+
+	if (n->level == 0) {
+		grid->m_cells[grid->index((int) x, (int) y, (int) z)] = 1;
+		return;
+	}
+
+	half = size >> 1;
+	for (i = 0; i < 8; i++) {
+		write(n->child[i], grid, x + ((i >> 2) * half), y + (((i >> 1) & 1) * half), z + ((i & 1) * half));
+	}
+}
+
+
+/**
+ *  Advances the root by 2^step generations.
+ */
+void HashLife::step(int step) {
+	int64_t offset;
+	int i;
+
+	// The result of a level k node only covers its centre, so the pattern
+	// is padded until it sits in the middle quarter and cannot grow out of
+	// that centre within 2^step <= 2^(k - 3) generations
+	for (i = 0; i < 2 || this->m_root->level < step + 3; i++) {
+		offset = (int64_t) 1 << (this->m_root->level - 1);
+		this->m_root = expand(this->m_root);
+		this->m_ox -= offset;
+		this->m_oy -= offset;
+		this->m_oz -= offset;
+	}
+
+	offset = (int64_t) 1 << (this->m_root->level - 2);
+	this->m_root = result(this->m_root, step);
+	this->m_ox += offset;
+	this->m_oy += offset;
+	this->m_oz += offset;
+
+	// Drop the empty padding again
+	while (this->m_root->level > 3) {
+		HashNode *c = centre(this->m_root);
+		if (c->population != this->m_root->population) break;
+
+		offset = (int64_t) 1 << (this->m_root->level - 2);
+		this->m_root = c;
+		this->m_ox += offset;
+		this->m_oy += offset;
+		this->m_oz += offset;
+	}
+
+	this->m_generation += (uint64_t) 1 << step;
+}
+
+
+void HashLife::mark(HashNode *n) {
+	int i;
+
+	if (n->level == 0 || n->marked) return;
+	n->marked = true;
+	for (i = 0; i < 8; i++) {
+		mark(n->child[i]);
+	}
+}
+
+
+/**
+ *  Frees every node the root and the empty nodes do not reach. Results
+ *  pointing at freed nodes are forgotten.
+ */
+void HashLife::collect() {
+	for (HashNode *n : this->m_nodes) {
+		n->marked = false;
+	}
+	mark(this->m_root);
+	for (HashNode *n : this->m_empty) {
+		mark(n);
+	}
+
+	for (HashNode *n : this->m_nodes) {
+		if (n->marked && n->result && !n->result->marked) {
+			n->result = nullptr;
+			n->result_step = -1;
+		}
+	}
+
+	for (auto it = this->m_nodes.begin(); it != this->m_nodes.end();) {
+		HashNode *n = *it;
+		if (n->marked) {
+			it++;
+		} else {
+			it = this->m_nodes.erase(it);
+			delete n;
+		}
+	}
+}
@@ -0,0 +1,148 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#include "life_worker.h"
+
+
+LifeWorker::LifeWorker(GameOfLife *life, ThreadPool *pool)
+	: m_mesher(life->x, life->y, life->z) {
+	this->m_life = life;
+	this->m_pool = pool;
+	this->m_mailbox.store(nullptr);
+	this->m_shown.store(0);
+	this->m_period.store(0);
+	this->m_requested = 0;
+	this->m_stop = false;
+	this->m_cycle_start = 0;
+
+	this->m_thread = std::thread(&LifeWorker::run, this);
+}
+
+
+LifeWorker::~LifeWorker() {
+	{
+		std::lock_guard<std::mutex> guard(this->m_lock);
+		this->m_stop = true;
+	}
+	this->m_wake.notify_one();
+	this->m_thread.join();
+
+	delete this->m_mailbox.exchange(nullptr);
+}
+
+
+void LifeWorker::request(int generations) {
+	{
+		std::lock_guard<std::mutex> guard(this->m_lock);
+		this->m_requested += generations;
+	}
+	this->m_wake.notify_one();
+}
+
+
+int LifeWorker::poll(ChunkMesher *mesher) {
+	LifeFrame *frame = this->m_mailbox.exchange(nullptr, std::memory_order_acq_rel);
+	int n;
+
+	if (!frame) return 0;
+
+	n = mesher->upload(frame->chunks);
+	this->m_shown.store(frame->generation, std::memory_order_relaxed);
+	delete frame;
+	return n;
+}
+
+
+uint64_t LifeWorker::generation() const {
+	return this->m_shown.load(std::memory_order_relaxed);
+}
+
+
+int LifeWorker::period() const {
+	return this->m_period.load(std::memory_order_relaxed);
+}
+
+
+// Private helper functions
+
+void LifeWorker::run() {
+	uint64_t done = 0;
+	int period;
+
+	// Every chunk starts out dirty, so the first frame is the whole grid
+	LifeFrame *frame = new LifeFrame();
+	frame->generation = 0;
+	this->m_mesher.build(this->m_life->m_current, this->m_pool);
+	this->m_mesher.take(frame->chunks);
+	publish(frame);
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(this->m_lock);
+			this->m_wake.wait(lock, [&] { return this->m_stop || this->m_requested > done; });
+			if (this->m_stop) return;
+		}
+
+		this->m_life->step_active();
+		done++;
+
+		frame = new LifeFrame();
+		frame->generation = done;
+		period = this->m_life->period();
+
+		// Oscillators repeat the same chunks every period, so after one
+		// round of meshing the chunks of each phase are replayed
+		if (period > 1 && (int) this->m_cycle.size() == period) {
+			frame->chunks = this->m_cycle[(done - this->m_cycle_start) % period];
+		} else {
+			this->m_mesher.mark(this->m_life->m_current, this->m_life->changed());
+			this->m_mesher.build(this->m_life->m_current, this->m_pool);
+			this->m_mesher.take(frame->chunks);
+
+			if (period > 1) {
+				if (this->m_cycle.empty()) this->m_cycle_start = done;
+				this->m_cycle.push_back(frame->chunks);
+			} else {
+				this->m_cycle.clear();
+			}
+		}
+		this->m_period.store(period, std::memory_order_relaxed);
+		publish(frame);
+	}
+}
+
+
+/**
+ *  Puts a frame in the mailbox. A frame the render thread has not picked up
+ *  yet is folded into the new one, its chunks are still needed wherever the
+ *  new frame did not remesh them.
+ */
+void LifeWorker::publish(LifeFrame *frame) {
+	LifeFrame *old = this->m_mailbox.exchange(nullptr, std::memory_order_acq_rel);
+
+	if (old) {
+		std::vector<uint8_t> fresh(this->m_mesher.chunks(), 0);
+
+		for (ChunkData &data : frame->chunks) {
+			fresh[data.chunk] = 1;
+		}
+		for (ChunkData &data : old->chunks) {
+			if (!fresh[data.chunk]) frame->chunks.push_back(std::move(data));
+		}
+		delete old;
+	}
+
+	this->m_mailbox.store(frame, std::memory_order_release);
+}
@@ -0,0 +1,282 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#include "mapped_grid.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "common.h"
+
+
+#define BRICK_CELLS (GRID_BRICK * GRID_BRICK * GRID_BRICK)
+
+
+static size_t layout_bytes(int x, int y, int z, GridLayout layout);
+static size_t brick_offset(int bx, int by, int bz, int nby, int nbz);
+static size_t page_size();
+
+
+MappedGrid::MappedGrid() {
+	this->m_data = NULL;
+	this->m_bytes = 0;
+#ifdef _WIN32
+	this->m_file = INVALID_HANDLE_VALUE;
+	this->m_mapping = NULL;
+#else
+	this->m_file = -1;
+#endif
+	this->x = 0;
+	this->y = 0;
+	this->z = 0;
+	this->layout = GRID_RAW;
+}
+
+
+MappedGrid::~MappedGrid() {
+	close();
+}
+
+
+int MappedGrid::open(const char *path, int x, int y, int z, GridLayout layout) {
+	size_t need = layout_bytes(x, y, z, layout);
+
+	close();
+
+#ifdef _WIN32
+	LARGE_INTEGER size;
+
+	this->m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (this->m_file == INVALID_HANDLE_VALUE) return CODE_INVALID_FILENAME;
+	if (!GetFileSizeEx(this->m_file, &size) || (size_t) size.QuadPart < need || need == 0) {
+		close();
+		return CODE_READING_ERROR;
+	}
+
+	this->m_mapping = CreateFileMappingA(this->m_file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	if (this->m_mapping) this->m_data = (uint8_t*) MapViewOfFile(this->m_mapping, FILE_MAP_COPY, 0, 0, need);
+	if (!this->m_data) {
+		close();
+		return CODE_READING_ERROR;
+	}
+#else
+	struct stat info;
+	void *data;
+
+	this->m_file = ::open(path, O_RDONLY);
+	if (this->m_file < 0) return CODE_INVALID_FILENAME;
+	if (fstat(this->m_file, &info) != 0 || (size_t) info.st_size < need || need == 0) {
+		close();
+		return CODE_READING_ERROR;
+	}
+
+	data = mmap(NULL, need, PROT_READ | PROT_WRITE, MAP_PRIVATE, this->m_file, 0);
+	if (data == MAP_FAILED) {
+		close();
+		return CODE_READING_ERROR;
+	}
+	this->m_data = (uint8_t*) data;
+
+	// Slabs are walked front to back
+	madvise(data, need, MADV_SEQUENTIAL);
+#endif
+
+	this->m_bytes = need;
+	this->x = x;
+	this->y = y;
+	this->z = z;
+	this->layout = layout;
+	return CODE_SUCCESS;
+}
+
+
+void MappedGrid::close() {
+#ifdef _WIN32
+	if (this->m_data) UnmapViewOfFile(this->m_data);
+	if (this->m_mapping) CloseHandle(this->m_mapping);
+	if (this->m_file != INVALID_HANDLE_VALUE) CloseHandle(this->m_file);
+	this->m_mapping = NULL;
+	this->m_file = INVALID_HANDLE_VALUE;
+#else
+	if (this->m_data) munmap(this->m_data, this->m_bytes);
+	if (this->m_file >= 0) ::close(this->m_file);
+	this->m_file = -1;
+#endif
+	this->m_data = NULL;
+	this->m_bytes = 0;
+	this->x = 0;
+	this->y = 0;
+	this->z = 0;
+}
+
+
+size_t MappedGrid::bytes() const {
+	return this->m_bytes;
+}
+
+
+uint8_t MappedGrid::get(int x, int y, int z) const {
+	const int nby = (this->y + GRID_BRICK - 1) >> GRID_BRICK_SHIFT;
+	const int nbz = (this->z + GRID_BRICK - 1) >> GRID_BRICK_SHIFT;
+	const int m = GRID_BRICK - 1;
+
+	if (this->layout == GRID_RAW) {
+		return this->m_data[(((size_t) x * this->y) + y) * this->z + z];
+	}
+	return this->m_data[brick_offset(x >> GRID_BRICK_SHIFT, y >> GRID_BRICK_SHIFT, z >> GRID_BRICK_SHIFT, nby, nbz) +
+	                    (((x & m) << (2 * GRID_BRICK_SHIFT)) | ((y & m) << GRID_BRICK_SHIFT) | (z & m))];
+}
+
+
+Grid *MappedGrid::slab(int x0, int x1) {
+	const int nby = (this->y + GRID_BRICK - 1) >> GRID_BRICK_SHIFT;
+	const int nbz = (this->z + GRID_BRICK - 1) >> GRID_BRICK_SHIFT;
+	const int m = GRID_BRICK - 1;
+	Grid *grid;
+	int x, y, z, bz;
+
+	if (this->layout == GRID_RAW) {
+		grid = new Grid(x1 - x0, this->y, this->z, this->m_data + (size_t) x0 * this->y * this->z);
+		grid->update_bricks();
+		return grid;
+	}
+
+	// Copy brick rows out a GRID_BRICK run of cells at a time
+	grid = new Grid(x1 - x0, this->y, this->z);
+	for (x = x0; x < x1; x++) {
+		for (y = 0; y < this->y; y++) {
+			uint8_t *row = grid->m_cells + grid->index(x - x0, y, 0);
+
+			for (bz = 0; bz < nbz; bz++) {
+				const uint8_t *src = this->m_data + brick_offset(x >> GRID_BRICK_SHIFT, y >> GRID_BRICK_SHIFT, bz, nby, nbz) +
+				                     (((x & m) << (2 * GRID_BRICK_SHIFT)) | ((y & m) << GRID_BRICK_SHIFT));
+				z = bz << GRID_BRICK_SHIFT;
+				memcpy(row + z, src, std::min(GRID_BRICK, this->z - z));
+			}
+		}
+	}
+	grid->update_bricks();
+	return grid;
+}
+
+
+void MappedGrid::release(int x0, int x1) {
+	const size_t page = page_size();
+	size_t lo, hi;
+
+	if (this->layout == GRID_RAW) {
+		lo = (size_t) x0 * this->y * this->z;
+		hi = (size_t) x1 * this->y * this->z;
+	} else {
+		const size_t plane = layout_bytes(GRID_BRICK, this->y, this->z, GRID_BRICKED);
+
+		// Bricks hold GRID_BRICK planes, only whole brick planes can go
+		lo = (size_t) ((x0 + GRID_BRICK - 1) >> GRID_BRICK_SHIFT) * plane;
+		hi = (size_t) (x1 >> GRID_BRICK_SHIFT) * plane;
+	}
+
+	// Partial pages at either end stay mapped
+	lo = (lo + page - 1) / page * page;
+	hi = std::min(hi, this->m_bytes) / page * page;
+	if (lo >= hi) return;
+
+#ifdef _WIN32
+	VirtualUnlock(this->m_data + lo, hi - lo);
+#else
+	madvise(this->m_data + lo, hi - lo, MADV_DONTNEED);
+#endif
+}
+
+
+int MappedGrid::write(const char *path, Grid *grid, GridLayout layout) {
+	const int nby = (grid->y + GRID_BRICK - 1) >> GRID_BRICK_SHIFT;
+	const int nbz = (grid->z + GRID_BRICK - 1) >> GRID_BRICK_SHIFT;
+	std::vector<uint8_t> brick(BRICK_CELLS);
+	FILE *file;
+	bool ok = true;
+	int bx, by, bz, x, y, z, n;
+
+	file = fopen(path, "wb");
+	if (!file) return CODE_INVALID_FILENAME;
+
+	if (layout == GRID_RAW) {
+		ok = fwrite(grid->m_cells, 1, (size_t) grid->x * grid->y * grid->z, file) == (size_t) grid->x * grid->y * grid->z;
+	} else {
+		for (bx = 0; ok && bx < ((grid->x + GRID_BRICK - 1) >> GRID_BRICK_SHIFT); bx++) {
+			for (by = 0; ok && by < nby; by++) {
+				for (bz = 0; ok && bz < nbz; bz++) {
+					std::fill(brick.begin(), brick.end(), (uint8_t) 0);
+					for (x = 0; x < GRID_BRICK && (bx << GRID_BRICK_SHIFT) + x < grid->x; x++) {
+						for (y = 0; y < GRID_BRICK && (by << GRID_BRICK_SHIFT) + y < grid->y; y++) {
+							z = bz << GRID_BRICK_SHIFT;
+							n = std::min(GRID_BRICK, grid->z - z);
+							memcpy(&brick[(x << (2 * GRID_BRICK_SHIFT)) | (y << GRID_BRICK_SHIFT)],
+							       grid->m_cells + grid->index((bx << GRID_BRICK_SHIFT) + x, (by << GRID_BRICK_SHIFT) + y, z), n);
+						}
+					}
+					ok = fwrite(brick.data(), 1, BRICK_CELLS, file) == BRICK_CELLS;
+				}
+			}
+		}
+	}
+
+	if (fclose(file) != 0) ok = false;
+	return ok ? CODE_SUCCESS : CODE_READING_ERROR;
+}
+
+
+// Private helper functions
+
+/**
+ *  @return Size of a volume file, bricked volumes are padded to whole bricks
+ */
+static size_t layout_bytes(int x, int y, int z, GridLayout layout) {
+	if (x <= 0 || y <= 0 || z <= 0) return 0;
+	if (layout == GRID_RAW) return (size_t) x * y * z;
+	return (size_t) ((x + GRID_BRICK - 1) >> GRID_BRICK_SHIFT) *
+	       ((y + GRID_BRICK - 1) >> GRID_BRICK_SHIFT) *
+	       ((z + GRID_BRICK - 1) >> GRID_BRICK_SHIFT) * BRICK_CELLS;
+}
+
+
+/**
+ *  @return Offset of the first cell of a brick in a bricked volume
+ */
+static size_t brick_offset(int bx, int by, int bz, int nby, int nbz) {
+	return ((((size_t) bx * nby) + by) * nbz + bz) * BRICK_CELLS;
+}
+
+
+static size_t page_size() {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+#else
+	return (size_t) sysconf(_SC_PAGESIZE);
+#endif
+}
@@ -15,73 +15,1178 @@
 */
 #include "mcubes.h"
 
-#include <vector>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#include "cpu.h"
 #include "tables.h"
 
 
-Mesh* MarchingCubeGenerator::generate(Grid* grid) {
-	Mesh* mesh = new Mesh();
-	std::vector<Vertex> vertices = std::vector<Vertex>();
-    Vertex v0, v1, v2;
-    vec3 norm, q, r;
+// Slabs handed out per worker, more than one keeps uneven slabs balanced.
+#define MC_SLABS_PER_WORKER (4)
+
+// Marks an edge that has no vertex yet.
+#define MC_NO_VERTEX (0xFFFFFFFFu)
+
+
+/**
+ *  Remembers which vertex was emitted for each lattice edge. Only the two
+ *  x-planes touched by the current layer of cells are kept: y and z edges
+ *  live in a plane, x edges span the gap between the planes. Coordinates are
+ *  relative to the corner of the region being meshed.
+ */
+struct EdgeCache {
+	std::vector<unsigned int> planes[2];
+	std::vector<unsigned int> spans;
+	int y, z;
+	
+	EdgeCache(int y, int z) {
+		this->y = y;
+		this->z = z;
+		this->planes[0].assign(2 * y * z, MC_NO_VERTEX);
+		this->planes[1].assign(2 * y * z, MC_NO_VERTEX);
+		this->spans.assign(y * z, MC_NO_VERTEX);
+	}
+	
+	/**
+	 *  Moves on to the layer of cells between planes x and x + 1.
+	 */
+	void advance(int x) {
+		std::fill(this->planes[(x + 1) & 1].begin(), this->planes[(x + 1) & 1].end(), MC_NO_VERTEX);
+		std::fill(this->spans.begin(), this->spans.end(), MC_NO_VERTEX);
+	}
+	
+	unsigned int* slot(int x, int y, int z, int axis) {
+		if (axis == 0) return &this->spans[(y * this->z) + z];
+		return &this->planes[x & 1][(((y * this->z) + z) << 1) + axis - 1];
+	}
+};
+
+
+/**
+ *  Marks which bricks of cells the surface can pass through, a brick of
+ *  cells is skipped when every brick its corners touch is uniformly empty or
+ *  uniformly solid. Covers the cells in [x0:x1) along x.
+ */
+struct BrickMask {
+	std::vector<uint8_t> mixed;
+	std::vector<uint8_t> columns;
+	int bx0, nbx, nby, nbz;
+	
+	BrickMask(Grid* grid, int x0, int x1) {
+		int i, j, k, b;
+		
+		this->bx0 = x0 >> GRID_BRICK_SHIFT;
+		this->nbx = x1 > x0 ? ((x1 - 1) >> GRID_BRICK_SHIFT) - this->bx0 + 1 : 0;
+		this->nby = (grid->y - 1 + GRID_BRICK - 1) >> GRID_BRICK_SHIFT;
+		this->nbz = (grid->z - 1 + GRID_BRICK - 1) >> GRID_BRICK_SHIFT;
+		if (this->nby < 0) this->nby = 0;
+		if (this->nbz < 0) this->nbz = 0;
+		
+		this->mixed.assign(this->nbx * this->nby * this->nbz, 0);
+		this->columns.assign(this->nbx * this->nby, 0);
+		
+		for (b = 0, i = 0; i < this->nbx; i++) {
+			for (j = 0; j < this->nby; j++) {
+				for (k = 0; k < this->nbz; k++, b++) {
+					// Cells of a brick reach one sample into the next brick
+					int cx = (this->bx0 + i) << GRID_BRICK_SHIFT;
+					int cy = j << GRID_BRICK_SHIFT;
+					int cz = k << GRID_BRICK_SHIFT;
+					
+					if (grid->region_state(cx, cy, cz, cx + GRID_BRICK + 1, cy + GRID_BRICK + 1, cz + GRID_BRICK + 1) == BRICK_MIXED) {
+						this->mixed[b] = 1;
+						this->columns[(i * this->nby) + j] = 1;
+					}
+				}
+			}
+		}
+	}
+	
+	/**
+	 *  @return Per brick flags along z for the row of cells at x, y, nullptr
+	 *          if the surface misses the whole row.
+	 */
+	const uint8_t* row(int x, int y) const {
+		int col = (((x >> GRID_BRICK_SHIFT) - this->bx0) * this->nby) + (y >> GRID_BRICK_SHIFT);
+		return this->columns[col] ? &this->mixed[col * this->nbz] : nullptr;
+	}
+};
+
+
+/**
+ *  Boolean cells, vertices sit on edge midpoints and take their normals from
+ *  the faces around them.
+ */
+struct SolidCells {
+	Grid *grid;
+	const BrickMask *mask;
+	
+	static const bool FACE_NORMALS = true;
+	
+	int classify_row(int x, int y, int z0, int z1, uint8_t* cases, int* active) const {
+		const uint8_t *r00 = this->grid->m_cells + this->grid->index(x, y, 0);
+		const uint8_t *bricks = this->mask->row(x, y);
+		const int dx = this->grid->y * this->grid->z;
+		const int dy = this->grid->z;
+		int b0, b1, lo, hi, i, n, count = 0;
+		
+		if (!bricks) return 0;
+		
+		// Classify runs of mixed bricks, uniform ones cannot hold a surface
+		for (b0 = z0 >> GRID_BRICK_SHIFT; b0 <= (z1 - 1) >> GRID_BRICK_SHIFT; b0 = b1) {
+			if (!bricks[b0]) {
+				b1 = b0 + 1;
+				continue;
+			}
+			for (b1 = b0 + 1; b1 < this->mask->nbz && bricks[b1]; b1++);
+			
+			lo = std::max(b0 << GRID_BRICK_SHIFT, z0);
+			hi = std::min(b1 << GRID_BRICK_SHIFT, z1);
+			if (lo >= hi) continue;
+			
+			n = MarchingCubeGenerator::classify_row(r00 + lo, r00 + dx + lo, r00 + dy + lo, r00 + dx + dy + lo,
+			                                        hi - lo, cases + lo, active + count);
+			for (i = count; i < count + n; i++) {
+				active[i] += lo;
+			}
+			count += n;
+		}
+		return count;
+	}
+	
+	void place(int x, int y, int z, int edge, Vertex &v) const {
+		v.position[0] = MC_OFFSETS[edge][0] + (float)x;
+		v.position[1] = MC_OFFSETS[edge][1] + (float)y;
+		v.position[2] = MC_OFFSETS[edge][2] + (float)z;
+	}
+	
+	void layer(int) const {}
+};
+
+
+/**
+ *  Bit packed cells, same surface as SolidCells. Classifies 64 cells at a
+ *  time with word-wide ANDs and ORs and only builds the case index of cells
+ *  the surface passes through.
+ */
+struct BitCells {
+	BitGrid *grid;
+	
+	static const bool FACE_NORMALS = true;
+	
+	int classify_row(int x, int y, int z0, int z1, uint8_t* cases, int* active) const {
+		const uint64_t *r00 = this->grid->row(x, y);
+		const uint64_t *r10 = this->grid->row(x + 1, y);
+		const uint64_t *r01 = this->grid->row(x, y + 1);
+		const uint64_t *r11 = this->grid->row(x + 1, y + 1);
+		uint64_t c[8], any, all, act;
+		uint8_t index;
+		int w, i, z, count = 0;
+		
+		for (w = z0 >> 6; w <= (z1 - 1) >> 6; w++) {
+			c[0] = r00[w];
+			c[1] = r10[w];
+			c[2] = next(r10, w);
+			c[3] = next(r00, w);
+			c[4] = r01[w];
+			c[5] = r11[w];
+			c[6] = next(r11, w);
+			c[7] = next(r01, w);
+			
+			any = c[0] | c[1] | c[2] | c[3] | c[4] | c[5] | c[6] | c[7];
+			all = c[0] & c[1] & c[2] & c[3] & c[4] & c[5] & c[6] & c[7];
+			act = any & ~all & range(w, z0, z1);
+			
+			while (act) {
+				i = cpu_ctz64(act);
+				z = (w << 6) + i;
+				
+				index = 0;
+				for (int k = 0; k < 8; k++) {
+					index |= ((c[k] >> i) & 1) << k;
+				}
+				cases[z] = index;
+				active[count++] = z;
+				act &= act - 1;
+			}
+		}
+		return count;
+	}
+	
+	void place(int x, int y, int z, int edge, Vertex &v) const {
+		v.position[0] = MC_OFFSETS[edge][0] + (float)x;
+		v.position[1] = MC_OFFSETS[edge][1] + (float)y;
+		v.position[2] = MC_OFFSETS[edge][2] + (float)z;
+	}
+	
+	void layer(int) const {}
+	
+	/**
+	 *  Word w of a row shifted down by one cell, i.e. the samples at z + 1.
+	 */
+	uint64_t next(const uint64_t *r, int w) const {
+		return (r[w] >> 1) | (w + 1 < this->grid->words ? r[w + 1] << 63 : 0);
+	}
+	
+	/**
+	 *  Bits of word w that fall inside [z0:z1).
+	 */
+	static uint64_t range(int w, int z0, int z1) {
+		int lo = std::max(z0 - (w << 6), 0);
+		int hi = std::min(z1 - (w << 6), 64);
+		uint64_t top = hi >= 64 ? ~(uint64_t) 0 : (((uint64_t) 1 << hi) - 1);
+		return top & ~(((uint64_t) 1 << lo) - 1);
+	}
+};
+
+
+/**
+ *  Density samples, solid below the iso value. Vertices are interpolated to
+ *  the iso crossing along the edge and normals follow the density gradient,
+ *  from the field itself when one is given.
+ *
+ *  With a slice source the grid is only two planes deep and holds plane x
+ *  at x & 1, each layer streams in the plane after it. Central differences
+ *  need the planes either side, so streaming needs a field.
+ */
+struct DensityCells {
+	DensityGrid *grid;
+	float iso;
+	const DensityGradient *field;
+	const DensitySlice *slices;
+	int origin[3] = { 0, 0, 0 };    // Lattice point of sample (0, 0, 0)
+	int stride = 1;                 // Lattice steps between samples
+	
+	static const bool FACE_NORMALS = false;
+	
+	int classify_row(int x, int y, int z0, int z1, uint8_t* cases, int* active) const {
+		const float *r00 = row(x, y);
+		const float *r10 = row(x + 1, y);
+		const float *r01 = r00 + this->grid->z;
+		const float *r11 = r10 + this->grid->z;
+		uint8_t index;
+		int z, count = 0;
+		
+		for (z = z0; z < z1; z++) {
+			index = 0;
+			if (r00[z    ] < this->iso) index |= 1;
+			if (r10[z    ] < this->iso) index |= 2;
+			if (r10[z + 1] < this->iso) index |= 4;
+			if (r00[z + 1] < this->iso) index |= 8;
+			if (r01[z    ] < this->iso) index |= 16;
+			if (r11[z    ] < this->iso) index |= 32;
+			if (r11[z + 1] < this->iso) index |= 64;
+			if (r01[z + 1] < this->iso) index |= 128;
+			
+			cases[z] = index;
+			if (index != 0 && index != 255) active[count++] = z;
+		}
+		return count;
+	}
+	
+	void place(int x, int y, int z, int edge, Vertex &v) const {
+		const int8_t *o = MC_EDGE_ORIGIN[edge];
+		int a[3] = { x + o[0], y + o[1], z + o[2] };
+		int b[3] = { a[0], a[1], a[2] };
+		float va, vb, t;
+		vec3 ga, gb;
+		
+		b[o[3]]++;
+		va = row(a[0], a[1])[a[2]];
+		vb = row(b[0], b[1])[b[2]];
+		t = (vb != va) ? (this->iso - va) / (vb - va) : 0.5f;
+		
+		v.position[0] = (float) (this->origin[0] + (a[0] * this->stride));
+		v.position[1] = (float) (this->origin[1] + (a[1] * this->stride));
+		v.position[2] = (float) (this->origin[2] + (a[2] * this->stride));
+		v.position[o[3]] += t * (float) this->stride;
+		
+		if (this->field) {
+			(*this->field)(v.position, v.normal);
+			return;
+		}
+		gradient(a, ga);
+		gradient(b, gb);
+		vec3_lerp(ga, gb, t, v.normal);
+	}
+	
+	/**
+	 *  Central differences inside the grid, one-sided on its faces.
+	 */
+	void gradient(const int *p, vec3 g) const {
+		int axis, lo[3], hi[3];
+		
+		for (axis = 0; axis < 3; axis++) {
+			int len = axis == 0 ? this->grid->x : axis == 1 ? this->grid->y : this->grid->z;
+			
+			memcpy(lo, p, sizeof(lo));
+			memcpy(hi, p, sizeof(hi));
+			if (lo[axis] > 0) lo[axis]--;
+			if (hi[axis] < len - 1) hi[axis]++;
+			
+			g[axis] = (this->grid->m_values[this->grid->index(hi[0], hi[1], hi[2])] -
+			           this->grid->m_values[this->grid->index(lo[0], lo[1], lo[2])]) / (float)(hi[axis] - lo[axis]);
+		}
+	}
+	
+	void layer(int x) const {
+		if (this->slices) (*this->slices)(x + 1, row(x + 1, 0));
+	}
+	
+	/**
+	 *  Samples of plane x, row y.
+	 */
+	float* row(int x, int y) const {
+		return this->grid->m_values + this->grid->index(this->slices ? x & 1 : x, y, 0);
+	}
+};
+
+
+/**
+ *  Collects an indexed mesh in memory.
+ */
+struct MeshBuffers {
+	std::vector<Vertex> *vertices;
+	std::vector<unsigned int> *indices;
+	
+	unsigned int add(const Vertex &v) {
+		this->vertices->push_back(v);
+		return (unsigned int) this->vertices->size() - 1;
+	}
+	
+	Vertex& vertex(unsigned int i) {
+		return (*this->vertices)[i];
+	}
+	
+	void index(unsigned int i) {
+		this->indices->push_back(i);
+	}
+	
+	void layer() {}
+	
+	bool done() const {
+		return false;
+	}
+	
+	void finish() {
+		for (Vertex &v : *this->vertices) {
+			if (vec3_dot(v.normal, v.normal) > 0.0f) vec3_normalize(v.normal, v.normal);
+		}
+	}
+};
+
+
+/**
+ *  Streams an indexed mesh to files as it is built. A vertex is final once
+ *  both layers of cells around its plane are done, so only the vertices of
+ *  the last two layers are held in memory, and the indices of one layer.
+ */
+struct MeshStream {
+	FILE *vertex_file;
+	FILE *index_file;
+	std::vector<Vertex> window;
+	std::vector<unsigned int> pending;
+	unsigned int base;          // Id of window[0]
+	unsigned int mark;          // First vertex of the layer in progress
+	unsigned int next;
+	uint64_t vertices;
+	uint64_t indices;
+	bool failed;
+	bool overflow;              // More vertices than uint32_t indices can reach
+	
+	MeshStream(FILE *vertex_file, FILE *index_file) {
+		this->vertex_file = vertex_file;
+		this->index_file = index_file;
+		this->base = 0;
+		this->mark = 0;
+		this->next = 0;
+		this->vertices = 0;
+		this->indices = 0;
+		this->failed = false;
+		this->overflow = false;
+	}
+	
+	/**
+	 *  Ids wrap past 2^32 - 1. The window only ever spans two layers, so
+	 *  ids relative to base stay right, but the written indices would not.
+	 */
+	unsigned int add(const Vertex &v) {
+		if (++this->vertices > (uint64_t) UINT32_MAX + 1) this->overflow = this->failed = true;
+		this->window.push_back(v);
+		return this->next++;
+	}
+	
+	Vertex& vertex(unsigned int i) {
+		return this->window[i - this->base];
+	}
+	
+	void index(unsigned int i) {
+		this->pending.push_back(i);
+	}
+	
+	void layer() {
+		flush(this->mark);
+		this->mark = this->next;
+	}
+	
+	/**
+	 *  Nothing more is written once a write failed or ids ran out.
+	 */
+	bool done() const {
+		return this->failed;
+	}
+	
+	void finish() {
+		flush(this->next);
+	}
+	
+	/**
+	 *  Writes out the indices so far and every vertex before end, none of
+	 *  those vertices is touched again.
+	 */
+	void flush(unsigned int end) {
+		unsigned int n = end - this->base;
+		unsigned int i;
+		
+		for (i = 0; i < n; i++) {
+			Vertex &v = this->window[i];
+			if (vec3_dot(v.normal, v.normal) > 0.0f) vec3_normalize(v.normal, v.normal);
+		}
+		if (n && !this->failed && fwrite(this->window.data(), sizeof(Vertex), n, this->vertex_file) != n) this->failed = true;
+		
+		this->window.erase(this->window.begin(), this->window.begin() + n);
+		this->base = end;
+		
+		n = (unsigned int) this->pending.size();
+		if (n && !this->failed && fwrite(this->pending.data(), sizeof(unsigned int), n, this->index_file) != n) this->failed = true;
+		this->indices += n;
+		this->pending.clear();
+	}
+};
+
+
+/**
+ *  Cells of a MappedGrid, read in slabs of planes. layer() brings in the
+ *  next slab, one plane longer than the cells it covers, once the cells of
+ *  the last one are done and hands the pages of the old one back.
+ */
+struct MappedCells {
+	struct Slab {
+		Grid *grid;
+		BrickMask *mask;
+		int x0, x1;
+	};
+	
+	MappedGrid *grid;
+	Slab *slab;
+	int length;
+	
+	static const bool FACE_NORMALS = true;
+	
+	int classify_row(int x, int y, int z0, int z1, uint8_t* cases, int* active) const {
+		SolidCells cells = { this->slab->grid, this->slab->mask };
+		return cells.classify_row(x - this->slab->x0, y, z0, z1, cases, active);
+	}
+	
+	void place(int x, int y, int z, int edge, Vertex &v) const {
+		v.position[0] = MC_OFFSETS[edge][0] + (float)x;
+		v.position[1] = MC_OFFSETS[edge][1] + (float)y;
+		v.position[2] = MC_OFFSETS[edge][2] + (float)z;
+	}
+	
+	void layer(int x) const {
+		Slab *s = this->slab;
+		
+		if (s->grid && x < s->x1) return;
+		if (s->grid) this->grid->release(s->x0, s->x1);
+		delete s->mask;
+		delete s->grid;
+		
+		s->x0 = x;
+		s->x1 = std::min(x + this->length, this->grid->x - 1);
+		s->grid = this->grid->slab(s->x0, s->x1 + 1);
+		s->mask = new BrickMask(s->grid, 0, s->x1 - s->x0);
+	}
+};
+
+
+/**
+ *  Transition cells along one face of a chunk of DensityCells whose
+ *  neighbour across the face is sampled at half the stride. Every cell of
+ *  the face gets a transition cell of zero width, with 3 x 3 fine samples of
+ *  the neighbour on one side and the 2 x 2 coarse samples of the cell on the
+ *  other. Its surface is traced from the contours on its faces rather than
+ *  looked up in a table: crossings are paired walking around each face, and
+ *  ambiguous faces keep solid corners apart as MC_TRI_TABLE does, so the
+ *  fine cells of the neighbour and the coarse cells of the chunk meet it
+ *  along the same segments. Crossings are placed exactly like
+ *  DensityCells::place() places them on either side of the seam.
+ */
+struct TransitionCells {
+	const DensityCells *cells;
+	DensityGrid *fine;      // Face samples at half the stride, 2 * size + 1 along both axes
+	int axis, side, size;
+	std::vector<unsigned int> fine_edges;
+	std::vector<unsigned int> coarse_edges;
+	
+	// Per cell
+	int point[13][3];
+	float value[13];
+	int face[13][2];
+	bool solid[13];
+	
+	TransitionCells(const DensityCells *cells, DensityGrid *fine, int axis, int side, int size) {
+		this->cells = cells;
+		this->fine = fine;
+		this->axis = axis;
+		this->side = side;
+		this->size = size;
+		this->fine_edges.assign(2 * ((2 * size) + 1) * ((2 * size) + 1), MC_NO_VERTEX);
+		this->coarse_edges.assign(2 * (size + 1) * (size + 1), MC_NO_VERTEX);
+	}
+	
+	void mesh(MeshBuffers &out) {
+		int i, j;
+		
+		for (i = 0; i < this->size; i++) {
+			for (j = 0; j < this->size; j++) {
+				cell(i, j, out);
+			}
+		}
+	}
+	
+	void cell(int i, int j, MeshBuffers &out) {
+		const int u = (this->axis + 1) % 3;
+		const int v = (this->axis + 2) % 3;
+		const int stride = this->cells->stride;
+		int id[13][13];
+		int next[20], walk[5], loop[20];
+		unsigned int vertex[20];
+		bool enter[5];
+		int s, p, q, f, k, e, n, r, m, c, count = 0;
+		int g[3];
+		
+		for (s = 0; s < 13; s++) {
+			bool coarse = s >= 9;
+			int step = coarse ? stride : stride / 2;
+			
+			this->face[s][0] = coarse ? i + ((s - 9) >> 1) : (2 * i) + (s / 3);
+			this->face[s][1] = coarse ? j + ((s - 9) & 1) : (2 * j) + (s % 3);
+			
+			this->point[s][this->axis] = this->cells->origin[this->axis] + (this->side * this->size * stride);
+			this->point[s][u] = this->cells->origin[u] + (this->face[s][0] * step);
+			this->point[s][v] = this->cells->origin[v] + (this->face[s][1] * step);
+			
+			g[this->axis] = coarse ? this->side * this->size : 0;
+			g[u] = this->face[s][0];
+			g[v] = this->face[s][1];
+			this->value[s] = coarse ? this->cells->grid->m_values[this->cells->grid->index(g[0], g[1], g[2])]
+			                        : this->fine->m_values[this->fine->index(g[0], g[1], g[2])];
+			this->solid[s] = this->value[s] < this->cells->iso;
+			count += this->solid[s];
+		}
+		if (count == 0 || count == 13) return;
+		
+		count = 0;
+		memset(id, -1, sizeof(id));
+		
+		// Walk each face, every crossing into the solid is paired with the
+		// next crossing out of it
+		for (f = 0; f < 9; f++) {
+			const int8_t *ring = MC_TRANSITION_FACES[f];
+			
+			n = ring[4] < 0 ? 4 : 5;
+			r = 0;
+			for (k = 0; k < n; k++) {
+				p = ring[k];
+				q = ring[(k + 1) % n];
+				if (this->solid[p] == this->solid[q]) continue;
+				
+				if (id[p][q] < 0) {
+					vertex[count] = crossing(p, q, out);
+					next[count] = -1;
+					id[p][q] = id[q][p] = count++;
+				}
+				walk[r] = id[p][q];
+				enter[r] = this->solid[q];
+				r++;
+			}
+			if (r == 0) continue;
+			
+			for (e = 0; !enter[e]; e++);
+			for (k = 0; k < r; k += 2) {
+				next[walk[(e + k) % r]] = walk[(e + k + 1) % r];
+			}
+		}
+		
+		// Every crossing lies on two faces, so the segments close into loops
+		for (c = 0; c < count; c++) {
+			for (m = 0, k = c; next[k] >= 0; m++) {
+				loop[m] = k;
+				e = next[k];
+				next[k] = -1;
+				k = e;
+			}
+			
+			// The rings wind for a coarse face along +axis
+			for (k = 1; k + 1 < m; k++) {
+				out.index(vertex[loop[0]]);
+				out.index(vertex[loop[this->side ? k + 1 : k]]);
+				out.index(vertex[loop[this->side ? k : k + 1]]);
+			}
+		}
+	}
+	
+	/**
+	 *  Vertex where the surface crosses the edge between samples p and q,
+	 *  shared with the neighbouring transition cells.
+	 */
+	unsigned int crossing(int p, int q, MeshBuffers &out) {
+		unsigned int *slot = edge(p, q);
+		int a = p, b = q, k;
+		float t;
+		
+		if (slot && *slot != MC_NO_VERTEX) return *slot;
+		
+		for (k = 0; k < 3 && this->point[a][k] == this->point[b][k]; k++);
+		if (k < 3 && this->point[b][k] < this->point[a][k]) std::swap(a, b);
+		
+		Vertex vert = {};
+		t = (this->value[b] != this->value[a]) ? (this->cells->iso - this->value[a]) / (this->value[b] - this->value[a]) : 0.5f;
+		vert.position[0] = (float) this->point[a][0];
+		vert.position[1] = (float) this->point[a][1];
+		vert.position[2] = (float) this->point[a][2];
+		if (k < 3) vert.position[k] += t * (float) (this->point[b][k] - this->point[a][k]);
+		(*this->cells->field)(vert.position, vert.normal);
+		
+		if (!slot) return out.add(vert);
+		return *slot = out.add(vert);
+	}
+	
+	/**
+	 *  Vertex slot of the edge between samples p and q if both are fine or
+	 *  both coarse, nullptr for the edges of zero length joining the two.
+	 */
+	unsigned int* edge(int p, int q) {
+		int a = std::min(this->face[p][0], this->face[q][0]);
+		int b = std::min(this->face[p][1], this->face[q][1]);
+		int along = this->face[p][0] == this->face[q][0];
+		
+		if (p < 9 && q < 9) return &this->fine_edges[(((a * ((2 * this->size) + 1)) + b) << 1) + along];
+		if (p >= 9 && q >= 9) return &this->coarse_edges[(((a * (this->size + 1)) + b) << 1) + along];
+		return nullptr;
+	}
+};
+
+
+/**
+ *  Removes the vertices no index refers to, keeping the rest in order.
+ */
+static void drop_unused(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices) {
+	std::vector<unsigned int> remap(vertices.size(), MC_NO_VERTEX);
+	unsigned int n = 0;
+	size_t v;
+	
+	for (unsigned int i : indices) {
+		remap[i] = 0;
+	}
+	for (v = 0; v < vertices.size(); v++) {
+		if (remap[v] == MC_NO_VERTEX) continue;
+		remap[v] = n;
+		vertices[n++] = vertices[v];
+	}
+	vertices.resize(n);
+	for (unsigned int &i : indices) {
+		i = remap[i];
+	}
+}
+
+
+/**
+ *  Indexed marching cubes over any cell type providing classify_row(),
+ *  place() and layer(), limited to the cells in [x0:x1) x [y0:y1) x [z0:z1).
+ *  layer(x) runs before any cell between planes x and x + 1 is looked at.
+ *  Output goes to any sink providing add(), vertex(), index(), layer(),
+ *  done() and finish(). Meshing stops at the next layer once done() holds.
+ *
+ *  If core is given, { x0, y0, z0, x1, y1, z1 } of a box inside the region,
+ *  only the faces of cells in it are indexed. The cells around it still add
+ *  their face normals to the vertices they share with it.
+ */
+template <typename Cells, typename Output>
+static void mesh_cells(const Cells &cells, int x0, int y0, int z0, int x1, int y1, int z1, Output &out,
+                       const int *core = nullptr) {
+	const int sz = cells.grid->z;
+	EdgeCache cache(y1 - y0 + 1, z1 - z0 + 1);
+	std::vector<uint8_t> cases(sz > 1 ? sz - 1 : 0);
+	std::vector<int> active(sz > 1 ? sz - 1 : 0);
+	unsigned int tri[3];
+	unsigned int *slot;
+	const int8_t *edges;
+	const uint8_t *slots;
+	vec3 norm, q, r;
 	int x, y, z;
-	int i, c = 0;
+	int i, j, k, n, count;
 	uint8_t index;
+	bool emit;
 	
-	for (c = 0, x = 0; x < grid->x - 1; x++) {
-		for (y = 0; y < grid->y - 1; y++) {
-			for (z = 0; z < grid->z - 1; z++, c++) {
-				index = 0;
-				if (grid->m_cells[c                                    ]) index |= 1;
-				if (grid->m_cells[c + (grid->y * grid->z)              ]) index |= 2;
-				if (grid->m_cells[c + (grid->y * grid->z) +           1]) index |= 4;
-				if (grid->m_cells[c +                                 1]) index |= 8;
-				if (grid->m_cells[c +                       grid->z    ]) index |= 16;
-				if (grid->m_cells[c + (grid->y * grid->z) + grid->z    ]) index |= 32;
-				if (grid->m_cells[c + (grid->y * grid->z) + grid->z + 1]) index |= 64;
-				if (grid->m_cells[c +                       grid->z + 1]) index |= 128;
+	if (x0 >= x1 || y0 >= y1 || z0 >= z1) return;
+	
+	for (x = x0; x < x1; x++) {
+		cache.advance(x - x0);
+		cells.layer(x);
+		out.layer();
+		if (out.done()) return;
+		
+		for (y = y0; y < y1; y++) {
+			count = cells.classify_row(x, y, z0, z1, cases.data(), active.data());
+			
+			for (k = 0; k < count; k++) {
+				z = active[k];
+				index = cases[z];
+				edges = MC_TRI_TABLE[index];
+				slots = MC_TRI_SLOTS[index].data();
+				n = MC_TRI_COUNT[index] * 3;
+				emit = !core || (x >= core[0] && x < core[3] && y >= core[1] && y < core[4] &&
+				                 z >= core[2] && z < core[5]);
 				
-				if (MC_EDGE_TABLE[index]) {
-					for(i = 0; MC_TRI_TABLE[index][i] != -1; i += 3) {
-						Vertex v0, v1, v2;
-						
-						v0.position[0] = MC_OFFSETS[MC_TRI_TABLE[index][i    ]][0] + (float)x;
-						v0.position[1] = MC_OFFSETS[MC_TRI_TABLE[index][i    ]][1] + (float)y;
-						v0.position[2] = MC_OFFSETS[MC_TRI_TABLE[index][i    ]][2] + (float)z;
-						
-						v1.position[0] = MC_OFFSETS[MC_TRI_TABLE[index][i + 1]][0] + (float)x;
-						v1.position[1] = MC_OFFSETS[MC_TRI_TABLE[index][i + 1]][1] + (float)y;
-						v1.position[2] = MC_OFFSETS[MC_TRI_TABLE[index][i + 1]][2] + (float)z;
-						
-						v2.position[0] = MC_OFFSETS[MC_TRI_TABLE[index][i + 2]][0] + (float)x;
-						v2.position[1] = MC_OFFSETS[MC_TRI_TABLE[index][i + 2]][1] + (float)y;
-						v2.position[2] = MC_OFFSETS[MC_TRI_TABLE[index][i + 2]][2] + (float)z;
-						
-                        // Normal calculation
-                        vec3_sub(v1.position, v0.position, q);
-                        vec3_sub(v2.position, v0.position, r);
-                        vec3_cross(q, r, norm);
-                        memcpy(v0.normal, norm, sizeof(vec3));
-                        memcpy(v1.normal, norm, sizeof(vec3));
-                        memcpy(v2.normal, norm, sizeof(vec3));
+				for (i = 0; i < n; i += 3) {
+					for (j = 0; j < 3; j++) {
+						const int s = slots[i + j];
+						slot = cache.slot(x - x0 + (s & 1), y - y0 + ((s >> 1) & 1), z - z0 + ((s >> 2) & 1), s >> 3);
 						
-						vertices.push_back(v0);
-						vertices.push_back(v1);
-						vertices.push_back(v2);
+						if (*slot == MC_NO_VERTEX) {
+							Vertex v = {};
+							cells.place(x, y, z, edges[i + j], v);
+							*slot = out.add(v);
+						}
+						tri[j] = *slot;
+						if (emit) out.index(*slot);
+					}
+					
+					if (!Cells::FACE_NORMALS) continue;
+					
+					// Accumulate the face normal, normalized once every face is in
+					vec3_sub(out.vertex(tri[1]).position, out.vertex(tri[0]).position, q);
+					vec3_sub(out.vertex(tri[2]).position, out.vertex(tri[0]).position, r);
+					vec3_cross(q, r, norm);
+					for (j = 0; j < 3; j++) {
+						Vertex &v = out.vertex(tri[j]);
+						vec3_add(v.normal, norm, v.normal);
 					}
 				}
 			}
-			
-			// Skip last x cell.
-			c++;
 		}
+	}
+}
+
+
+/**
+ *  Indexed marching cubes into vectors, see mesh_cells().
+ *
+ *  With a pool the cells are split into x-slabs meshed on the workers, each
+ *  with one cell of halo on either side so the normals of its border
+ *  vertices match a single pass. Slabs are appended in order and do not
+ *  share vertices, those on the planes between them are repeated.
+ */
+template <typename Cells>
+static void mesh_indexed(const Cells &cells, int x0, int y0, int z0, int x1, int y1, int z1,
+                         std::vector<Vertex> &vertices, std::vector<unsigned int> &indices,
+                         ThreadPool *pool = nullptr) {
+	MeshBuffers out = { &vertices, &indices };
+	int slabs, s;
+	
+	vertices.clear();
+	indices.clear();
+	
+	if (!pool || pool->size() == 1 || x1 - x0 < 2) {
+		mesh_cells(cells, x0, y0, z0, x1, y1, z1, out);
+		out.finish();
+		return;
+	}
+	
+	slabs = std::min(pool->size() * MC_SLABS_PER_WORKER, x1 - x0);
+	
+	std::vector<std::vector<Vertex>> parts(slabs);
+	std::vector<std::vector<unsigned int>> part_indices(slabs);
+	pool->for_each(slabs, [&](int i) {
+		const int s0 = x0 + (int) (((long long) (x1 - x0) * i) / slabs);
+		const int s1 = x0 + (int) (((long long) (x1 - x0) * (i + 1)) / slabs);
+		const int core[6] = { s0, y0, z0, s1, y1, z1 };
+		MeshBuffers part = { &parts[i], &part_indices[i] };
 		
-		// Skip last y column.
-		c += grid->z;
+		mesh_cells(cells, std::max(s0 - 1, x0), y0, z0, std::min(s1 + 1, x1), y1, z1, part, core);
+		part.finish();
+		drop_unused(parts[i], part_indices[i]);
+	});
+	
+	// Prefix-sum the slab sizes so every slab knows where its output starts
+	std::vector<size_t> offsets(slabs + 1), index_offsets(slabs + 1);
+	for (offsets[0] = 0, index_offsets[0] = 0, s = 0; s < slabs; s++) {
+		offsets[s + 1] = offsets[s] + parts[s].size();
+		index_offsets[s + 1] = index_offsets[s] + part_indices[s].size();
 	}
 	
+	vertices.resize(offsets[slabs]);
+	indices.resize(index_offsets[slabs]);
+	pool->for_each(slabs, [&](int i) {
+		const unsigned int base = (unsigned int) offsets[i];
+		unsigned int *dst = indices.data() + index_offsets[i];
+		
+		std::copy(parts[i].begin(), parts[i].end(), vertices.begin() + offsets[i]);
+		for (unsigned int index : part_indices[i]) {
+			*dst++ = index + base;
+		}
+	});
+}
+
+
+Mesh* MarchingCubeGenerator::generate(Grid* grid) {
+	return generate(grid, nullptr);
+}
+
+
+Mesh* MarchingCubeGenerator::generate(Grid* grid, ThreadPool* pool) {
+	Mesh* mesh = new Mesh();
+	std::vector<Vertex> vertices = std::vector<Vertex>();
+	
+	generate(grid, vertices, pool);
+	
 	mesh_create(mesh, vertices.data(), vertices.size(), nullptr, 0);
 	return mesh;
 }
 
 
+void MarchingCubeGenerator::generate(Grid* grid, std::vector<Vertex>& vertices, ThreadPool* pool) {
+	int cells = grid->x - 1;
+	int slabs, s;
+	
+	vertices.clear();
+	if (cells <= 0) return;
+	
+	if (!pool || pool->size() == 1) {
+		generate_slab(grid, 0, cells, vertices);
+		return;
+	}
+	
+	// Mesh each slab into its own buffer
+	slabs = pool->size() * MC_SLABS_PER_WORKER;
+	if (slabs > cells) slabs = cells;
+	
+	std::vector<std::vector<Vertex>> parts(slabs);
+	pool->for_each(slabs, [&](int i) {
+		int x0 = (int) (((long long) cells * i) / slabs);
+		int x1 = (int) (((long long) cells * (i + 1)) / slabs);
+		generate_slab(grid, x0, x1, parts[i]);
+	});
+	
+	// Prefix-sum the slab sizes so every slab knows where its output starts,
+	// keeping the vertex order identical to a single threaded pass.
+	std::vector<size_t> offsets(slabs + 1);
+	for (offsets[0] = 0, s = 0; s < slabs; s++) {
+		offsets[s + 1] = offsets[s] + parts[s].size();
+	}
+	
+	vertices.resize(offsets[slabs]);
+	pool->for_each(slabs, [&](int i) {
+		if (!parts[i].empty()) {
+			memcpy(vertices.data() + offsets[i], parts[i].data(), parts[i].size() * sizeof(Vertex));
+		}
+	});
+}
+
+
+Mesh* MarchingCubeGenerator::generate_indexed(Grid* grid) {
+	Mesh* mesh = new Mesh();
+	std::vector<Vertex> vertices = std::vector<Vertex>();
+	std::vector<unsigned int> indices = std::vector<unsigned int>();
+	
+	generate_indexed(grid, vertices, indices);
+	
+	mesh_create(mesh, vertices.data(), vertices.size(), indices.data(), indices.size());
+	return mesh;
+}
+
+
+void MarchingCubeGenerator::generate_indexed(Grid* grid, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+	generate_indexed(grid, 0, 0, 0, grid->x - 1, grid->y - 1, grid->z - 1, vertices, indices);
+}
+
+
+void MarchingCubeGenerator::generate_indexed(Grid* grid, int x0, int y0, int z0, int x1, int y1, int z1,
+                                             std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+	MeshBuffers out = { &vertices, &indices };
+	const int core[6] = { x0, y0, z0, x1, y1, z1 };
+	
+	// One cell around the region adds its face normals to the border
+	// vertices, in the same order meshing the whole grid adds them
+	const int lo[3] = { std::max(x0 - 1, 0), std::max(y0 - 1, 0), std::max(z0 - 1, 0) };
+	const int hi[3] = { std::min(x1 + 1, grid->x - 1), std::min(y1 + 1, grid->y - 1), std::min(z1 + 1, grid->z - 1) };
+	
+	vertices.clear();
+	indices.clear();
+	if (x0 >= x1 || y0 >= y1 || z0 >= z1) return;
+	
+	BrickMask mask(grid, lo[0], hi[0]);
+	SolidCells cells = { grid, &mask };
+	mesh_cells(cells, lo[0], lo[1], lo[2], hi[0], hi[1], hi[2], out, core);
+	out.finish();
+	drop_unused(vertices, indices);
+}
+
+
+Mesh* MarchingCubeGenerator::generate_indexed(BitGrid* grid) {
+	Mesh* mesh = new Mesh();
+	std::vector<Vertex> vertices = std::vector<Vertex>();
+	std::vector<unsigned int> indices = std::vector<unsigned int>();
+	
+	generate_indexed(grid, vertices, indices);
+	
+	mesh_create(mesh, vertices.data(), vertices.size(), indices.data(), indices.size());
+	return mesh;
+}
+
+
+void MarchingCubeGenerator::generate_indexed(BitGrid* grid, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+	BitCells cells = { grid };
+	mesh_indexed(cells, 0, 0, 0, grid->x - 1, grid->y - 1, grid->z - 1, vertices, indices);
+}
+
+
+Mesh* MarchingCubeGenerator::generate(DensityGrid* grid, float iso) {
+	Mesh* mesh = new Mesh();
+	std::vector<Vertex> vertices = std::vector<Vertex>();
+	std::vector<unsigned int> indices = std::vector<unsigned int>();
+	
+	generate(grid, iso, vertices, indices);
+	
+	mesh_create(mesh, vertices.data(), vertices.size(), indices.data(), indices.size());
+	return mesh;
+}
+
+
+void MarchingCubeGenerator::generate(DensityGrid* grid, float iso, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                                     ThreadPool* pool) {
+	DensityCells cells = { grid, iso, nullptr, nullptr };
+	mesh_indexed(cells, 0, 0, 0, grid->x - 1, grid->y - 1, grid->z - 1, vertices, indices, pool);
+}
+
+
+Mesh* MarchingCubeGenerator::generate(DensityGrid* grid, float iso, const DensityGradient& gradient) {
+	Mesh* mesh = new Mesh();
+	std::vector<Vertex> vertices = std::vector<Vertex>();
+	std::vector<unsigned int> indices = std::vector<unsigned int>();
+	
+	generate(grid, iso, gradient, vertices, indices);
+	
+	mesh_create(mesh, vertices.data(), vertices.size(), indices.data(), indices.size());
+	return mesh;
+}
+
+
+void MarchingCubeGenerator::generate(DensityGrid* grid, float iso, const DensityGradient& gradient,
+                                     std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+	DensityCells cells = { grid, iso, &gradient, nullptr };
+	mesh_indexed(cells, 0, 0, 0, grid->x - 1, grid->y - 1, grid->z - 1, vertices, indices);
+}
+
+
+Mesh* MarchingCubeGenerator::generate_streamed(int x, int y, int z, float iso, const DensitySlice& slice,
+                                               const DensityGradient& gradient) {
+	Mesh* mesh = new Mesh();
+	std::vector<Vertex> vertices = std::vector<Vertex>();
+	std::vector<unsigned int> indices = std::vector<unsigned int>();
+	
+	generate_streamed(x, y, z, iso, slice, gradient, vertices, indices);
+	
+	mesh_create(mesh, vertices.data(), vertices.size(), indices.data(), indices.size());
+	return mesh;
+}
+
+
+void MarchingCubeGenerator::generate_streamed(int x, int y, int z, float iso, const DensitySlice& slice,
+                                              const DensityGradient& gradient,
+                                              std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+	vertices.clear();
+	indices.clear();
+	if (x < 2 || y < 2 || z < 2) return;
+	
+	DensityGrid ring(2, y, z);
+	DensityCells cells = { &ring, iso, &gradient, &slice };
+	
+	// Every later plane comes in through layer()
+	slice(0, ring.m_values);
+	mesh_indexed(cells, 0, 0, 0, x - 1, y - 1, z - 1, vertices, indices);
+}
+
+
+Mesh* MarchingCubeGenerator::generate_lod(int x, int y, int z, int size, int stride, float iso, int transitions,
+                                          const DensityBox& fill, const DensityGradient& gradient) {
+	Mesh* mesh = new Mesh();
+	std::vector<Vertex> vertices = std::vector<Vertex>();
+	std::vector<unsigned int> indices = std::vector<unsigned int>();
+	
+	generate_lod(x, y, z, size, stride, iso, transitions, fill, gradient, vertices, indices);
+	
+	mesh_create(mesh, vertices.data(), vertices.size(), indices.data(), indices.size());
+	return mesh;
+}
+
+
+void MarchingCubeGenerator::generate_lod(int x, int y, int z, int size, int stride, float iso, int transitions,
+                                         const DensityBox& fill, const DensityGradient& gradient,
+                                         std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+	MeshBuffers out = { &vertices, &indices };
+	int face, axis, corner[3], dims[3];
+	
+	vertices.clear();
+	indices.clear();
+	if (size < 1 || stride < 1) return;
+	
+	DensityGrid grid(size + 1, size + 1, size + 1);
+	DensityCells cells = { &grid, iso, &gradient, nullptr, { x, y, z }, stride };
+	
+	fill(x, y, z, stride, &grid);
+	mesh_cells(cells, 0, 0, 0, size, size, size, out);
+	
+	// Nothing is finer than a stride of 1
+	for (face = 0; face < 6 && stride > 1; face++) {
+		if (!(transitions & (1 << face))) continue;
+		
+		axis = face >> 1;
+		corner[0] = x;
+		corner[1] = y;
+		corner[2] = z;
+		corner[axis] += (face & 1) * size * stride;
+		dims[0] = dims[1] = dims[2] = (2 * size) + 1;
+		dims[axis] = 1;
+		
+		DensityGrid samples(dims[0], dims[1], dims[2]);
+		fill(corner[0], corner[1], corner[2], stride / 2, &samples);
+		
+		TransitionCells transition(&cells, &samples, axis, face & 1, size);
+		transition.mesh(out);
+	}
+	out.finish();
+}
+
+
+int MarchingCubeGenerator::generate_file(MappedGrid* volume, const char* path, MeshFileStats* stats, int slab) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	MeshFileHeader header = { MC_FILE_MAGIC, (uint32_t) sizeof(Vertex), 0, 0 };
+	MappedCells::Slab state = { nullptr, nullptr, 0, 0 };
+	MappedCells cells = { volume, &state, std::max(slab, 1) };
+	std::vector<char> chunk(1 << 20);
+	FILE *file, *scratch;
+	size_t n;
+	bool ok;
+	
+	file = fopen(path, "wb");
+	if (!file) return CODE_INVALID_FILENAME;
+	scratch = tmpfile();
+	if (!scratch) {
+		fclose(file);
+		remove(path);
+		return CODE_READING_ERROR;
+	}
+	
+	// The header is filled in once the counts are known
+	ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	
+	MeshStream out(file, scratch);
+	mesh_cells(cells, 0, 0, 0, volume->x - 1, volume->y - 1, volume->z - 1, out);
+	out.finish();
+	ok = ok && !out.failed;
+	
+	if (state.grid) volume->release(state.x0, state.x1 + 1);
+	delete state.mask;
+	delete state.grid;
+	
+	// Indices go after the last vertex
+	rewind(scratch);
+	while (ok && (n = fread(chunk.data(), 1, chunk.size(), scratch)) > 0) {
+		ok = fwrite(chunk.data(), 1, n, file) == n;
+	}
+	ok = ok && !ferror(scratch);
+	fclose(scratch);
+	
+	header.vertices = out.vertices;
+	header.indices = out.indices;
+	ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+	if (fclose(file) != 0) ok = false;
+	if (out.overflow || !ok) {
+		remove(path);
+		return out.overflow ? CODE_INDEX_OUT_OF_BOUNDS : CODE_READING_ERROR;
+	}
+	
+	if (stats) {
+		stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		stats->megabytes = (double) volume->bytes() / (1024.0 * 1024.0);
+		stats->mb_per_second = stats->seconds > 0.0 ? stats->megabytes / stats->seconds : 0.0;
+		stats->vertices = header.vertices;
+		stats->indices = header.indices;
+	}
+	return CODE_SUCCESS;
+}
+
+
+// Private helper functions
+
+void MarchingCubeGenerator::generate_slab(Grid* grid, int x0, int x1, std::vector<Vertex>& vertices) {
+	BrickMask mask(grid, x0, x1);
+	SolidCells cells = { grid, &mask };
+	std::vector<uint8_t> cases(grid->z > 1 ? grid->z - 1 : 0);
+	std::vector<int> active(grid->z > 1 ? grid->z - 1 : 0);
+    vec3 norm, q, r;
+	int x, y, z;
+	const int8_t *edges;
+	int i, k, n, count;
+	uint8_t index;
+	
+	if (grid->z < 2) return;
+	
+	for (x = x0; x < x1; x++) {
+		for (y = 0; y < grid->y - 1; y++) {
+			count = cells.classify_row(x, y, 0, grid->z - 1, cases.data(), active.data());
+			
+			// Only cells the surface passes through make it this far
+			for (k = 0; k < count; k++) {
+				z = active[k];
+				index = cases[z];
+				edges = MC_TRI_TABLE[index];
+				n = MC_TRI_COUNT[index] * 3;
+				
+				for (i = 0; i < n; i += 3) {
+					Vertex v0, v1, v2;
+					
+					v0.position[0] = MC_OFFSETS[edges[i    ]][0] + (float)x;
+					v0.position[1] = MC_OFFSETS[edges[i    ]][1] + (float)y;
+					v0.position[2] = MC_OFFSETS[edges[i    ]][2] + (float)z;
+					
+					v1.position[0] = MC_OFFSETS[edges[i + 1]][0] + (float)x;
+					v1.position[1] = MC_OFFSETS[edges[i + 1]][1] + (float)y;
+					v1.position[2] = MC_OFFSETS[edges[i + 1]][2] + (float)z;
+					
+					v2.position[0] = MC_OFFSETS[edges[i + 2]][0] + (float)x;
+					v2.position[1] = MC_OFFSETS[edges[i + 2]][1] + (float)y;
+					v2.position[2] = MC_OFFSETS[edges[i + 2]][2] + (float)z;
+					
+                    // Normal calculation
+                    vec3_sub(v1.position, v0.position, q);
+                    vec3_sub(v2.position, v0.position, r);
+                    vec3_cross(q, r, norm);
+                    memcpy(v0.normal, norm, sizeof(vec3));
+                    memcpy(v1.normal, norm, sizeof(vec3));
+                    memcpy(v2.normal, norm, sizeof(vec3));
+					
+					vertices.push_back(v0);
+					vertices.push_back(v1);
+					vertices.push_back(v2);
+				}
+			}
+		}
+	}
+}
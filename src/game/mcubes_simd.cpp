@@ -0,0 +1,161 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#include "mcubes.h"
+#include "cpu.h"
+
+
+typedef int (*ClassifyRowFn)(const uint8_t*, const uint8_t*, const uint8_t*, const uint8_t*, int, uint8_t*, int*);
+
+
+/**
+ *  Scalar reference, also finishes the tail of the vector kernels.
+ */
+static int classify_scalar(const uint8_t* r00, const uint8_t* r10, const uint8_t* r01, const uint8_t* r11,
+                           int z0, int n, uint8_t* cases, int* active, int count) {
+	uint8_t index;
+	int z;
+	
+	for (z = z0; z < n; z++) {
+		index = 0;
+		if (r00[z    ]) index |= 1;
+		if (r10[z    ]) index |= 2;
+		if (r10[z + 1]) index |= 4;
+		if (r00[z + 1]) index |= 8;
+		if (r01[z    ]) index |= 16;
+		if (r11[z    ]) index |= 32;
+		if (r11[z + 1]) index |= 64;
+		if (r01[z + 1]) index |= 128;
+		
+		cases[z] = index;
+		if (index != 0 && index != 255) active[count++] = z;
+	}
+	return count;
+}
+
+
+static int classify_row_scalar(const uint8_t* r00, const uint8_t* r10, const uint8_t* r01, const uint8_t* r11,
+                               int n, uint8_t* cases, int* active) {
+	return classify_scalar(r00, r10, r01, r11, 0, n, cases, active, 0);
+}
+
+
+#if CPU_SSE2
+
+static inline __m128i corner_sse2(const uint8_t* row, int z, __m128i zero, int bit) {
+	__m128i v = _mm_loadu_si128((const __m128i*) (row + z));
+	return _mm_andnot_si128(_mm_cmpeq_epi8(v, zero), _mm_set1_epi8((char) bit));
+}
+
+
+/**
+ *  16 cells per iteration, each corner sample is widened to its case bit with
+ *  a compare against zero.
+ */
+static int classify_row_sse2(const uint8_t* r00, const uint8_t* r10, const uint8_t* r01, const uint8_t* r11,
+                             int n, uint8_t* cases, int* active) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i full = _mm_set1_epi8((char) 0xFF);
+	__m128i index;
+	uint32_t mask;
+	int z, count = 0;
+	
+	// The +1 corners read one sample past the last cell
+	for (z = 0; z + 16 <= n; z += 16) {
+		index =                      corner_sse2(r00, z,     zero, 1);
+		index = _mm_or_si128(index,  corner_sse2(r10, z,     zero, 2));
+		index = _mm_or_si128(index,  corner_sse2(r10, z + 1, zero, 4));
+		index = _mm_or_si128(index,  corner_sse2(r00, z + 1, zero, 8));
+		index = _mm_or_si128(index,  corner_sse2(r01, z,     zero, 16));
+		index = _mm_or_si128(index,  corner_sse2(r11, z,     zero, 32));
+		index = _mm_or_si128(index,  corner_sse2(r11, z + 1, zero, 64));
+		index = _mm_or_si128(index,  corner_sse2(r01, z + 1, zero, 128));
+		_mm_storeu_si128((__m128i*) (cases + z), index);
+		
+		mask = (uint32_t) _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(index, zero), _mm_cmpeq_epi8(index, full)));
+		mask = ~mask & 0xFFFF;
+		while (mask) {
+			active[count++] = z + cpu_ctz(mask);
+			mask &= mask - 1;
+		}
+	}
+	return classify_scalar(r00, r10, r01, r11, z, n, cases, active, count);
+}
+
+#endif
+
+
+#if CPU_X86
+
+CPU_TARGET_AVX2
+static inline __m256i corner_avx2(const uint8_t* row, int z, __m256i zero, int bit) {
+	__m256i v = _mm256_loadu_si256((const __m256i*) (row + z));
+	return _mm256_andnot_si256(_mm256_cmpeq_epi8(v, zero), _mm256_set1_epi8((char) bit));
+}
+
+
+/**
+ *  Same as the SSE2 kernel with 32 cells per iteration.
+ */
+CPU_TARGET_AVX2
+static int classify_row_avx2(const uint8_t* r00, const uint8_t* r10, const uint8_t* r01, const uint8_t* r11,
+                             int n, uint8_t* cases, int* active) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i full = _mm256_set1_epi8((char) 0xFF);
+	__m256i index;
+	uint32_t mask;
+	int z, count = 0;
+	
+	for (z = 0; z + 32 <= n; z += 32) {
+		index =                        corner_avx2(r00, z,     zero, 1);
+		index = _mm256_or_si256(index, corner_avx2(r10, z,     zero, 2));
+		index = _mm256_or_si256(index, corner_avx2(r10, z + 1, zero, 4));
+		index = _mm256_or_si256(index, corner_avx2(r00, z + 1, zero, 8));
+		index = _mm256_or_si256(index, corner_avx2(r01, z,     zero, 16));
+		index = _mm256_or_si256(index, corner_avx2(r11, z,     zero, 32));
+		index = _mm256_or_si256(index, corner_avx2(r11, z + 1, zero, 64));
+		index = _mm256_or_si256(index, corner_avx2(r01, z + 1, zero, 128));
+		_mm256_storeu_si256((__m256i*) (cases + z), index);
+		
+		mask = ~(uint32_t) _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(index, zero), _mm256_cmpeq_epi8(index, full)));
+		while (mask) {
+			active[count++] = z + cpu_ctz(mask);
+			mask &= mask - 1;
+		}
+	}
+	return classify_scalar(r00, r10, r01, r11, z, n, cases, active, count);
+}
+
+#endif
+
+
+static ClassifyRowFn select_classify_row() {
+#if CPU_X86
+	if (cpu_has_avx2()) return classify_row_avx2;
+#endif
+#if CPU_SSE2
+	if (cpu_has_sse2()) return classify_row_sse2;
+#endif
+	return classify_row_scalar;
+}
+
+
+static const ClassifyRowFn CLASSIFY_ROW = select_classify_row();
+
+
+int MarchingCubeGenerator::classify_row(const uint8_t* r00, const uint8_t* r10, const uint8_t* r01, const uint8_t* r11,
+                                        int n, uint8_t* cases, int* active) {
+	return CLASSIFY_ROW(r00, r10, r01, r11, n, cases, active);
+}
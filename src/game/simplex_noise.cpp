@@ -28,36 +28,123 @@
 */
 #include "simplex_noise.h"
 #include "mcubes.h"
+#include "cpu.h"
+
+
+// Permutation of [0:255], hashes lattice points to gradients
+static const short P[256] = {
+	151,160,137,91,90,15,
+	131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,
+	190,6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,57,177,33,
+	88,237,149,56,87,174,20,125,136,171,168,68,175,74,165,71,134,139,48,27,166,
+	77,146,158,231,83,111,229,122,60,211,133,230,220,105,92,41,55,46,245,40,244,
+	102,143,54,65,25,63,161,1,216,80,73,209,76,132,187,208,89,18,169,200,196,
+	135,130,116,188,159,86,164,100,109,198,173,186,3,64,52,217,226,250,124,123,
+	5,202,38,147,118,126,255,82,85,212,207,206,59,227,47,16,58,17,182,189,28,42,
+	223,183,170,213,119,248,152,2,44,154,163,70,221,153,101,155,167,43,172,9,
+	129,22,39,253,19,98,108,110,79,113,224,232,178,185,112,104,218,246,97,228,
+	251,34,242,193,238,210,144,12,191,179,162,241,81,51,145,235,249,14,239,107,
+	49,192,214,31,181,199,106,157,184,84,204,176,115,121,50,45,127,4,150,254,
+	138,236,205,93,222,114,67,29,24,72,243,141,128,195,78,66,215,61,156,180
+};
+
+static const double GRAD[12][3] = {
+	{  1,  1,  0},
+	{ -1,  1,  0},
+	{  1, -1,  0},
+	{ -1, -1,  0},
+	{  1,  0,  1},
+	{ -1,  0,  1},
+	{  1,  0, -1},
+	{ -1,  0, -1},
+	{  0,  1,  1},
+	{  0, -1,  1},
+	{  0,  1, -1},
+	{  0, -1, -1}
+};
+
+// GRAD in single precision. The vector kernels compute the same dot products
+// without a table: gradients 0-3 lie in xy, 4-7 in xz and 8-11 in yz, bit 0
+// negates the first axis and bit 1 the second.
+static const float GRADF[12][3] = {
+	{  1,  1,  0},
+	{ -1,  1,  0},
+	{  1, -1,  0},
+	{ -1, -1,  0},
+	{  1,  0,  1},
+	{ -1,  0,  1},
+	{  1,  0, -1},
+	{ -1,  0, -1},
+	{  0,  1,  1},
+	{  0, -1,  1},
+	{  0,  1, -1},
+	{  0, -1, -1}
+};
+
+// Offsets of the second and third simplex corners, indexed by the ordering
+// of the x, y, z distances from the cell origin.
+static const int IJK12S[8][6] = {
+	{0, 0, 1, 0, 1, 1}, // zyx
+	{0, 1, 0, 0, 1, 1}, // yzx
+	{0, 0, 0, 0, 0, 0}, // invalid
+	{0, 1, 0, 1, 1, 0}, // yxz
+	{0, 0, 1, 1, 0, 1}, // zxy
+	{0, 0, 0, 0, 0, 0}, // invalid
+	{1, 0, 0, 1, 0, 1}, // xzy
+	{1, 0, 0, 1, 1, 0}  // xyz
+};
+
+
+// Skew and unskew factors of the float kernels
+#define F3 (1.0f / 3.0f)
+#define G3 (1.0f / 6.0f)
+
+
+// Rows of the joined j, k permutation table, one more than P for the +1
+// corner
+#define PERM_JK_SIZE (257)
 
 
 /**
+ *  To remove the need for index wrapping, the permutation table is doubled in
+ *  length. Entries are 32 bit so the vector kernels can gather them.
  * 
+ *  The vector kernels also look up perm[j + perm[k]] in one step from
+ *  perm_jk[j * PERM_JK_SIZE + k], padded so a 32 bit gather of the last
+ *  entry stays inside the table. Built once before main().
  */
-void simplex_noise(Grid *grid) {
+struct PermTable {
+	int32_t perm[512];
+	int32_t perm_mod12[512];
+	uint8_t perm_jk[PERM_JK_SIZE * PERM_JK_SIZE + 3];
 	
-	// To remove the need for index wrapping, double the permutation table length
-	short p[512] = {
-		151,160,137,91,90,15,
-		131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,
-		190,6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,57,177,33,
-		88,237,149,56,87,174,20,125,136,171,168,68,175,74,165,71,134,139,48,27,166,
-		77,146,158,231,83,111,229,122,60,211,133,230,220,105,92,41,55,46,245,40,244,
-		102,143,54,65,25,63,161,1,216,80,73,209,76,132,187,208,89,18,169,200,196,
-		135,130,116,188,159,86,164,100,109,198,173,186,3,64,52,217,226,250,124,123,
-		5,202,38,147,118,126,255,82,85,212,207,206,59,227,47,16,58,17,182,189,28,42,
-		223,183,170,213,119,248,152,2,44,154,163,70,221,153,101,155,167,43,172,9,
-		129,22,39,253,19,98,108,110,79,113,224,232,178,185,112,104,218,246,97,228,
-		251,34,242,193,238,210,144,12,191,179,162,241,81,51,145,235,249,14,239,107,
-		49,192,214,31,181,199,106,157,184,84,204,176,115,121,50,45,127,4,150,254,
-		138,236,205,93,222,114,67,29,24,72,243,141,128,195,78,66,215,61,156,180
-	};
-	short perm[512];
-	short permMod12[512];
-	for (int i = 0; i < 512; i++) {
-		perm[i] = p[i & 0xFF];
-		permMod12[i] = (short) (perm[i] % 12);
+	PermTable(const short *p) {
+		int j, k;
+		
+		for (int i = 0; i < 512; i++) {
+			perm[i] = p[i & 0xFF];
+			perm_mod12[i] = perm[i] % 12;
+		}
+		for (j = 0; j < PERM_JK_SIZE; j++) {
+		for (k = 0; k < PERM_JK_SIZE; k++) {
+			perm_jk[j * PERM_JK_SIZE + k] = (uint8_t) perm[j + perm[k]];
+		}}
 	}
-	
+};
+
+
+static const PermTable TABLE(P);
+
+
+static inline int fast_floor(double v) {
+	int i = (int) v;
+	return v < i ? i - 1 : i;
+}
+
+
+double simplex_noise(double x, double y, double z) {
+	const int32_t *perm = TABLE.perm;
+	const int32_t *permMod12 = TABLE.perm_mod12;
 	double t0, t1, t2, t3;
 	double n0, n1, n2, n3;
 	double s;
@@ -66,149 +153,816 @@ void simplex_noise(Grid *grid) {
 	double x1, y1, z1;
 	double x2, y2, z2;
 	double x3, y3, z3;
-	double grad[12][3] = {
-		{  1,  1,  0},
-		{ -1,  1,  0},
-		{  1, -1,  0},
-		{ -1, -1,  0},
-		{  1,  0,  1},
-		{ -1,  0,  1},
-		{  1,  0, -1},
-		{ -1,  0, -1},
-		{  0,  1,  1},
-		{  0, -1,  1},
-		{  0,  1, -1},
-		{  0, -1, -1}
-	};
 	int gi0, gi1, gi2, gi3;
-	int x, y, z;
 	int i, j, k;
 	int ii, jj, kk;
-	int *ijk12;
-	int ijk12s[8][6] = {
-		{0, 0, 1, 0, 1, 1}, // zyx
-		{0, 1, 0, 0, 1, 1}, // yzx
-		{0, 0, 0, 0, 0, 0}, // invalid
-		{0, 1, 0, 1, 1, 0}, // yxz
-		{0, 0, 1, 1, 0, 1}, // zxy
-		{0, 0, 0, 0, 0, 0}, // invalid
-		{1, 0, 0, 1, 0, 1}, // xzy
-		{1, 0, 0, 1, 1, 0}  // xyz
-	};
+	const int *ijk12;
+	
+	// Skew the input space to determine which simplex cell we're in
+	
+	// Very nice and simple skew factor for 3D
+	s = (x + y + z) / 3.0;
+	i = fast_floor(x + s);
+	j = fast_floor(y + s);
+	k = fast_floor(z + s);
+	t = (i + j + k) / 6.0;
+	
+	// Unskew the cell origin back to (x,y,z) space
+	// The x,y,z distances from the cell origin
+	x0 = x - i + t;
+	y0 = y - j + t;
+	z0 = z - k + t;
+	
+	// For the 3D case, the simplex shape is a slightly irregular tetrahedron.
+	// Determine which simplex we are in.
+	
+	// Offsets for second and third corners of simplex in (i,j,k) coords.
+	ijk12 = IJK12S[
+		(x0 >= y0) << 2 |
+		(x0 >= z0) << 1 |
+		(y0 >= z0)
+	];
+	
+	// A step of (1,0,0) in (i,j,k) means a step of (1-c,-c,-c) in (x,y,z),
+	// a step of (0,1,0) in (i,j,k) means a step of (-c,1-c,-c) in (x,y,z), and
+	// a step of (0,0,1) in (i,j,k) means a step of (-c,-c,1-c) in (x,y,z), where
+	
+	// Offsets for second corner in (x,y,z) coords.
+	x1 = x0 - ijk12[0] + (1.0 / 6.0);
+	y1 = y0 - ijk12[1] + (1.0 / 6.0);
+	z1 = z0 - ijk12[2] + (1.0 / 6.0);
+	
+	// Offsets for third corner in (x,y,z) coords.
+	x2 = x0 - ijk12[3] + (1.0 / 3.0);
+	y2 = y0 - ijk12[4] + (1.0 / 3.0);
+	z2 = z0 - ijk12[5] + (1.0 / 3.0);
+	
+	// Offsets for last corner in (x,y,z) coords.
+	x3 = x0 - 0.5;
+	y3 = y0 - 0.5;
+	z3 = z0 - 0.5;
+	
+	// Work out the hashed gradient indices of the four simplex corners
+	ii = i & 0xFF;
+	jj = j & 0xFF;
+	kk = k & 0xFF;
+	gi0 = permMod12[ii + perm[jj + perm[kk]]];
+	gi1 = permMod12[ii + ijk12[0] + perm[jj + ijk12[1] + perm[kk + ijk12[2]]]];
+	gi2 = permMod12[ii + ijk12[3] + perm[jj + ijk12[4] + perm[kk + ijk12[5]]]];
+	gi3 = permMod12[ii + 1 + perm[jj + 1 + perm[kk + 1]]];
+	
+	// Calculate the contribution from the four corners
+	t0 = 0.5 - (x0 * x0) - (y0 * y0) - (z0 * z0);
+	t1 = 0.5 - (x1 * x1) - (y1 * y1) - (z1 * z1);
+	t2 = 0.5 - (x2 * x2) - (y2 * y2) - (z2 * z2);
+	t3 = 0.5 - (x3 * x3) - (y3 * y3) - (z3 * z3);
+	
+	if (t0 < 0) {
+		n0 = 0.0;
+	} else {
+		t0 *= t0;
+		n0 = t0 * t0 * (
+			(GRAD[gi0][0] * x0) +
+			(GRAD[gi0][1] * y0) +
+			(GRAD[gi0][2] * z0)
+		);
+	}
+	
+	if (t1 < 0) {
+		n1 = 0.0;
+	} else {
+		t1 *= t1;
+		n1 = t1 * t1 * (
+			(GRAD[gi1][0] * x1) +
+			(GRAD[gi1][1] * y1) +
+			(GRAD[gi1][2] * z1)
+		);
+	}
+	
+	if (t2 < 0) {
+		n2 = 0.0;
+	} else {
+		t2 *= t2;
+		n2 = t2 * t2 * (
+			(GRAD[gi2][0] * x2) +
+			(GRAD[gi2][1] * y2) +
+			(GRAD[gi2][2] * z2)
+		);
+	}
+	
+	if (t3 < 0) {
+		n3 = 0.0;
+	} else {
+		t3 *= t3;
+		n3 = t3 * t3 * (
+			(GRAD[gi3][0] * x3) +
+			(GRAD[gi3][1] * y3) +
+			(GRAD[gi3][2] * z3)
+		);
+	}
+	
+	// Add contributions from each corner to get the final noise value.
+	// The result is scaled to stay just inside [-1,1]
+	return 32.0 * (n0 + n1 + n2 + n3);
+}
+
+
+static inline int fast_floorf(float v) {
+	int i = (int) v;
+	return v < i ? i - 1 : i;
+}
+
+
+static inline float corner(float x, float y, float z, int gi) {
+	float t = 0.5f - (x * x) - (y * y) - (z * z);
+	
+	if (t < 0) return 0.0f;
+	t *= t;
+	return t * t * (
+		(GRADF[gi][0] * x) +
+		(GRADF[gi][1] * y) +
+		(GRADF[gi][2] * z)
+	);
+}
+
+
+/**
+ *  Derivative of a corner contribution t^4 (g . d), with t = 0.5 - d . d,
+ *  added to grad. Returns the contribution itself, rounded the same way as
+ *  corner().
+ */
+static inline float corner_grad(float x, float y, float z, int gi, float *grad) {
+	float t = 0.5f - (x * x) - (y * y) - (z * z);
+	float t2, dot, s;
+	
+	if (t < 0) return 0.0f;
+	t2 = t * t;
+	dot = (GRADF[gi][0] * x) + (GRADF[gi][1] * y) + (GRADF[gi][2] * z);
+	
+	// t^4 g - 8 t^3 (g . d) d
+	s = -8.0f * t2 * t * dot;
+	grad[0] += t2 * t2 * GRADF[gi][0] + s * x;
+	grad[1] += t2 * t2 * GRADF[gi][1] + s * y;
+	grad[2] += t2 * t2 * GRADF[gi][2] + s * z;
+	return t2 * t2 * dot;
+}
+
+
+/**
+ *  Finds the simplex holding (x, y, z), the offsets d of the point from its
+ *  four corners and the gradient index of each corner.
+ */
+static inline void simplex_corners(const PermTable *table, float x, float y, float z, float d[4][3], int gi[4]) {
+	const int32_t *perm = table->perm;
+	const int32_t *permMod12 = table->perm_mod12;
+	float s, t;
+	float x0, y0, z0;
+	int i, j, k;
+	int ii, jj, kk;
+	int i1, j1, k1;
+	int i2, j2, k2;
+	bool xy, xz, yz;
+	
+	s = (x + y + z) * F3;
+	i = fast_floorf(x + s);
+	j = fast_floorf(y + s);
+	k = fast_floorf(z + s);
+	t = (float) (i + j + k) * G3;
+	
+	x0 = x - (float) i + t;
+	y0 = y - (float) j + t;
+	z0 = z - (float) k + t;
+	
+	// Same corners as IJK12S, worked out from the comparisons so the vector
+	// kernels can do it with masks
+	xy = x0 >= y0;
+	xz = x0 >= z0;
+	yz = y0 >= z0;
+	i1 = xy && xz;
+	j1 = !xy && yz;
+	k1 = !xz && !yz;
+	i2 = xy || xz;
+	j2 = !xy || yz;
+	k2 = !(xz && yz);
+	
+	ii = i & 0xFF;
+	jj = j & 0xFF;
+	kk = k & 0xFF;
+	gi[0] = permMod12[ii + perm[jj + perm[kk]]];
+	gi[1] = permMod12[ii + i1 + perm[jj + j1 + perm[kk + k1]]];
+	gi[2] = permMod12[ii + i2 + perm[jj + j2 + perm[kk + k2]]];
+	gi[3] = permMod12[ii + 1 + perm[jj + 1 + perm[kk + 1]]];
+	
+	d[0][0] = x0;
+	d[0][1] = y0;
+	d[0][2] = z0;
+	d[1][0] = x0 - (float) i1 + G3;
+	d[1][1] = y0 - (float) j1 + G3;
+	d[1][2] = z0 - (float) k1 + G3;
+	d[2][0] = x0 - (float) i2 + 2.0f * G3;
+	d[2][1] = y0 - (float) j2 + 2.0f * G3;
+	d[2][2] = z0 - (float) k2 + 2.0f * G3;
+	d[3][0] = x0 - 0.5f;
+	d[3][1] = y0 - 0.5f;
+	d[3][2] = z0 - 0.5f;
+}
+
+
+static float noise_float(const PermTable *table, float x, float y, float z) {
+	float d[4][3];
+	int gi[4];
+	
+	simplex_corners(table, x, y, z, d, gi);
+	
+	// Adding 0 turns -0 into 0. The vector kernels sum the dot products
+	// without the zero gradient term, so only then do they agree on the sign.
+	return 32.0f * (
+		corner(d[0][0], d[0][1], d[0][2], gi[0]) +
+		corner(d[1][0], d[1][1], d[1][2], gi[1]) +
+		corner(d[2][0], d[2][1], d[2][2], gi[2]) +
+		corner(d[3][0], d[3][1], d[3][2], gi[3])
+	) + 0.0f;
+}
+
+
+/**
+ *  noise_float() and its gradient from the same four corners. The corner
+ *  offsets move one to one with the point, so no chain rule is needed.
+ */
+static float noise_grad(const PermTable *table, float x, float y, float z, float *grad) {
+	float d[4][3];
+	float n;
+	int gi[4];
+	
+	simplex_corners(table, x, y, z, d, gi);
+	grad[0] = grad[1] = grad[2] = 0.0f;
+	n = corner_grad(d[0][0], d[0][1], d[0][2], gi[0], grad) +
+	    corner_grad(d[1][0], d[1][1], d[1][2], gi[1], grad) +
+	    corner_grad(d[2][0], d[2][1], d[2][2], gi[2], grad) +
+	    corner_grad(d[3][0], d[3][1], d[3][2], gi[3], grad);
+	
+	grad[0] *= 32.0f;
+	grad[1] *= 32.0f;
+	grad[2] *= 32.0f;
+	return (32.0f * n) + 0.0f;
+}
+
+
+float simplex_noise_float(float x, float y, float z) {
+	return noise_float(&TABLE, x, y, z);
+}
+
+
+float simplex_noise_grad(float x, float y, float z, vec3 grad) {
+	return noise_grad(&TABLE, x, y, z, grad);
+}
+
+
+/**
+ *  Row kernels sample out[i] at (x, y, z + dz * (first + i)). Offsetting by
+ *  an index rather than moving z keeps every sample a function of its index
+ *  alone, however a row is split up.
+ */
+typedef void (*NoiseRowFn)(const PermTable*, float, float, float, float, int, int, float*);
+
+
+/**
+ *  Scalar reference, also finishes the tail of the vector kernels.
+ */
+static void noise_scalar(const PermTable *table, float x, float y, float z, float dz, int first, int i0, int n, float *out) {
+	int i;
+	
+	for (i = i0; i < n; i++) {
+		out[i] = noise_float(table, x, y, z + dz * (float) (first + i));
+	}
+}
+
+
+static void noise_row_scalar(const PermTable *table, float x, float y, float z, float dz, int first, int n, float *out) {
+	noise_scalar(table, x, y, z, dz, first, 0, n, out);
+}
+
+
+#if CPU_SSE2
+
+static inline __m128 select_sse2(__m128 mask, __m128 a, __m128 b) {
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+
+static inline __m128i floor_sse2(__m128 v) {
+	__m128i i = _mm_cvttps_epi32(v);
+	return _mm_add_epi32(i, _mm_castps_si128(_mm_cmplt_ps(v, _mm_cvtepi32_ps(i))));
+}
+
+
+static inline __m128i gather_sse2(const int32_t *table, __m128i index) {
+	int32_t lane[4];
+	
+	_mm_storeu_si128((__m128i*) lane, index);
+	return _mm_setr_epi32(table[lane[0]], table[lane[1]], table[lane[2]], table[lane[3]]);
+}
+
+
+static inline __m128i hash_sse2(const PermTable *table, __m128i ii, __m128i jj, __m128i kk) {
+	int32_t lane[4];
+	__m128i h;
+	
+	// jj * PERM_JK_SIZE + kk
+	_mm_storeu_si128((__m128i*) lane, _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(jj, 8), jj), kk));
+	h = _mm_setr_epi32(table->perm_jk[lane[0]], table->perm_jk[lane[1]], table->perm_jk[lane[2]], table->perm_jk[lane[3]]);
+	return gather_sse2(table->perm_mod12, _mm_add_epi32(ii, h));
+}
+
+
+static inline __m128 corner_sse2(__m128 x, __m128 y, __m128 z, __m128i gi) {
+	__m128 t = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_set1_ps(0.5f), _mm_mul_ps(x, x)), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+	__m128 u = select_sse2(_mm_castsi128_ps(_mm_cmplt_epi32(gi, _mm_set1_epi32(8))), x, y);
+	__m128 v = select_sse2(_mm_castsi128_ps(_mm_cmplt_epi32(gi, _mm_set1_epi32(4))), y, z);
+	
+	u = _mm_xor_ps(u, _mm_castsi128_ps(_mm_slli_epi32(gi, 31)));
+	v = _mm_xor_ps(v, _mm_castsi128_ps(_mm_slli_epi32(_mm_srli_epi32(gi, 1), 31)));
+	t = _mm_max_ps(t, _mm_setzero_ps());
+	t = _mm_mul_ps(t, t);
+	return _mm_mul_ps(_mm_mul_ps(t, t), _mm_add_ps(u, v));
+}
+
+
+/**
+ *  4 samples per iteration. SSE2 has no gather, so the hashes go through
+ *  memory one lane at a time.
+ */
+static void noise_row_sse2(const PermTable *table, float x, float y, float z, float dz, int first, int n, float *out) {
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 g3 = _mm_set1_ps(G3);
+	const __m128 g3x2 = _mm_set1_ps(2.0f * G3);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128i wrap = _mm_set1_epi32(0xFF);
+	const __m128i next = _mm_set1_epi32(1);
+	const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+	const __m128 vx = _mm_set1_ps(x);
+	const __m128 vy = _mm_set1_ps(y);
+	__m128 vz, s, t;
+	__m128 x0, y0, z0;
+	__m128 xy, xz, yz;
+	__m128 i1, j1, k1, i2, j2, k2;
+	__m128i i, j, k, ii, jj, kk;
+	__m128 n0, n1, n2, n3;
 	int c;
-    
-	for (c = 0, x = 0; x < grid->x; x++) {
-	for (y = 0; y < grid->y; y++) {
-	for (z = 0; z < grid->z; z++, c++) {
-		
-		// Skew the input space to determine which simplex cell we're in
-		
-		// Very nice and simple skew factor for 3D
-		s = (x + y + z) / 3.0;
-		ii = (int) (x + s);
-		i = i < ii ? ii - 1 : ii;
-		jj = (int) (y + s);
-		j = j < jj ? jj - 1 : jj;
-		kk = (int) (z + s);
-		k = k < kk ? kk - 1 : kk;
-		t = (i + j + k) / 6.0;
+	
+	for (c = 0; c + 4 <= n; c += 4) {
+		vz = _mm_add_ps(_mm_set1_ps(z), _mm_mul_ps(_mm_set1_ps(dz), _mm_add_ps(_mm_set1_ps((float) (first + c)), lanes)));
 		
-		// Unskew the cell origin back to (x,y,z) space
-		// The x,y,z distances from the cell origin
-		x0 = x - i + t;
-		y0 = y - j + t;
-		z0 = z - k + t;
+		s = _mm_mul_ps(_mm_add_ps(_mm_add_ps(vx, vy), vz), _mm_set1_ps(F3));
+		i = floor_sse2(_mm_add_ps(vx, s));
+		j = floor_sse2(_mm_add_ps(vy, s));
+		k = floor_sse2(_mm_add_ps(vz, s));
+		t = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_add_epi32(i, j), k)), g3);
 		
-		// For the 3D case, the simplex shape is a slightly irregular tetrahedron.
-		// Determine which simplex we are in.
+		x0 = _mm_add_ps(_mm_sub_ps(vx, _mm_cvtepi32_ps(i)), t);
+		y0 = _mm_add_ps(_mm_sub_ps(vy, _mm_cvtepi32_ps(j)), t);
+		z0 = _mm_add_ps(_mm_sub_ps(vz, _mm_cvtepi32_ps(k)), t);
 		
-		// Offsets for second and third corners of simplex in (i,j,k) coords.
-		ijk12 = ijk12s[
-			(x0 >= y0) << 2 |
-			(x0 >= z0) << 1 |
-			(y0 >= z0)
-		];
+		xy = _mm_cmpge_ps(x0, y0);
+		xz = _mm_cmpge_ps(x0, z0);
+		yz = _mm_cmpge_ps(y0, z0);
+		i1 = _mm_and_ps(_mm_and_ps(xy, xz), one);
+		j1 = _mm_and_ps(_mm_andnot_ps(xy, yz), one);
+		k1 = _mm_andnot_ps(_mm_or_ps(xz, yz), one);
+		i2 = _mm_and_ps(_mm_or_ps(xy, xz), one);
+		j2 = _mm_andnot_ps(_mm_andnot_ps(yz, xy), one);
+		k2 = _mm_andnot_ps(_mm_and_ps(xz, yz), one);
 		
-		// A step of (1,0,0) in (i,j,k) means a step of (1-c,-c,-c) in (x,y,z),
-		// a step of (0,1,0) in (i,j,k) means a step of (-c,1-c,-c) in (x,y,z), and
-		// a step of (0,0,1) in (i,j,k) means a step of (-c,-c,1-c) in (x,y,z), where
+		ii = _mm_and_si128(i, wrap);
+		jj = _mm_and_si128(j, wrap);
+		kk = _mm_and_si128(k, wrap);
 		
-		// Offsets for second corner in (x,y,z) coords.
-		x1 = x0 - ijk12[0] + (1.0 / 6.0);
-		y1 = y0 - ijk12[1] + (1.0 / 6.0);
-		z1 = z0 - ijk12[2] + (1.0 / 6.0);
+		n0 = corner_sse2(x0, y0, z0, hash_sse2(table, ii, jj, kk));
+		n1 = corner_sse2(
+			_mm_add_ps(_mm_sub_ps(x0, i1), g3),
+			_mm_add_ps(_mm_sub_ps(y0, j1), g3),
+			_mm_add_ps(_mm_sub_ps(z0, k1), g3),
+			hash_sse2(table, _mm_add_epi32(ii, _mm_cvtps_epi32(i1)), _mm_add_epi32(jj, _mm_cvtps_epi32(j1)), _mm_add_epi32(kk, _mm_cvtps_epi32(k1)))
+		);
+		n2 = corner_sse2(
+			_mm_add_ps(_mm_sub_ps(x0, i2), g3x2),
+			_mm_add_ps(_mm_sub_ps(y0, j2), g3x2),
+			_mm_add_ps(_mm_sub_ps(z0, k2), g3x2),
+			hash_sse2(table, _mm_add_epi32(ii, _mm_cvtps_epi32(i2)), _mm_add_epi32(jj, _mm_cvtps_epi32(j2)), _mm_add_epi32(kk, _mm_cvtps_epi32(k2)))
+		);
+		n3 = corner_sse2(
+			_mm_sub_ps(x0, half),
+			_mm_sub_ps(y0, half),
+			_mm_sub_ps(z0, half),
+			hash_sse2(table, _mm_add_epi32(ii, next), _mm_add_epi32(jj, next), _mm_add_epi32(kk, next))
+		);
 		
-		// Offsets for third corner in (x,y,z) coords.
-		x2 = x0 - ijk12[3] + (1.0 / 3.0);
-		y2 = y0 - ijk12[4] + (1.0 / 3.0);
-		z2 = z0 - ijk12[5] + (1.0 / 3.0);
+		n0 = _mm_mul_ps(_mm_set1_ps(32.0f), _mm_add_ps(_mm_add_ps(_mm_add_ps(n0, n1), n2), n3));
+		_mm_storeu_ps(out + c, _mm_add_ps(n0, _mm_setzero_ps()));
+	}
+	noise_scalar(table, x, y, z, dz, first, c, n, out);
+}
+
+#endif
+
+
+#if CPU_X86
+
+CPU_TARGET_AVX2
+static inline __m256i floor_avx2(__m256 v) {
+	return _mm256_cvtps_epi32(_mm256_floor_ps(v));
+}
+
+
+CPU_TARGET_AVX2
+static inline __m256i hash_avx2(const PermTable *table, __m256i ii, __m256i jk) {
+	__m256i h = _mm256_i32gather_epi32((const int*) table->perm_jk, jk, 1);
+	
+	h = _mm256_and_si256(h, _mm256_set1_epi32(0xFF));
+	return _mm256_i32gather_epi32(table->perm_mod12, _mm256_add_epi32(ii, h), 4);
+}
+
+
+/**
+ *  Hash of the corner offset from (ii, jk) by the 0 or ~0 lane masks mi, mj
+ *  and mk.
+ */
+CPU_TARGET_AVX2
+static inline __m256i hash_offset_avx2(const PermTable *table, __m256i ii, __m256i jk, __m256 mi, __m256 mj, __m256 mk) {
+	const __m256i row = _mm256_set1_epi32(PERM_JK_SIZE);
+	
+	ii = _mm256_sub_epi32(ii, _mm256_castps_si256(mi));
+	jk = _mm256_add_epi32(jk, _mm256_and_si256(_mm256_castps_si256(mj), row));
+	jk = _mm256_sub_epi32(jk, _mm256_castps_si256(mk));
+	return hash_avx2(table, ii, jk);
+}
+
+
+CPU_TARGET_AVX2
+static inline __m256 corner_avx2(__m256 x, __m256 y, __m256 z, __m256i gi) {
+	__m256 t = _mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(0.5f), _mm256_mul_ps(x, x)), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+	__m256 u = _mm256_blendv_ps(x, y, _mm256_castsi256_ps(_mm256_cmpgt_epi32(gi, _mm256_set1_epi32(7))));
+	__m256 v = _mm256_blendv_ps(y, z, _mm256_castsi256_ps(_mm256_cmpgt_epi32(gi, _mm256_set1_epi32(3))));
+	
+	u = _mm256_xor_ps(u, _mm256_castsi256_ps(_mm256_slli_epi32(gi, 31)));
+	v = _mm256_xor_ps(v, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_srli_epi32(gi, 1), 31)));
+	t = _mm256_max_ps(t, _mm256_setzero_ps());
+	t = _mm256_mul_ps(t, t);
+	return _mm256_mul_ps(_mm256_mul_ps(t, t), _mm256_add_ps(u, v));
+}
+
+
+/**
+ *  Same as the SSE2 kernel with 8 samples per iteration and the hashes
+ *  gathered straight from the permutation tables.
+ */
+CPU_TARGET_AVX2
+static void noise_row_avx2(const PermTable *table, float x, float y, float z, float dz, int first, int n, float *out) {
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 g3 = _mm256_set1_ps(G3);
+	const __m256 g3x2 = _mm256_set1_ps(2.0f * G3);
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 full = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+	const __m256i wrap = _mm256_set1_epi32(0xFF);
+	const __m256 lanes = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+	const __m256 vx = _mm256_set1_ps(x);
+	const __m256 vy = _mm256_set1_ps(y);
+	__m256 vz, s, t;
+	__m256 x0, y0, z0;
+	__m256 xy, xz, yz;
+	__m256 i1, j1, k1, i2, j2, k2;
+	__m256i i, j, k, ii, jj, jk;
+	__m256 n0, n1, n2, n3;
+	int c;
+	
+	for (c = 0; c + 8 <= n; c += 8) {
+		vz = _mm256_add_ps(_mm256_set1_ps(z), _mm256_mul_ps(_mm256_set1_ps(dz), _mm256_add_ps(_mm256_set1_ps((float) (first + c)), lanes)));
 		
-		// Offsets for last corner in (x,y,z) coords.
-		x3 = x0 - 0.5;
-		y3 = y0 - 0.5;
-		z3 = z0 - 0.5;
+		s = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(vx, vy), vz), _mm256_set1_ps(F3));
+		i = floor_avx2(_mm256_add_ps(vx, s));
+		j = floor_avx2(_mm256_add_ps(vy, s));
+		k = floor_avx2(_mm256_add_ps(vz, s));
+		t = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_add_epi32(i, j), k)), g3);
 		
-		// Work out the hashed gradient indices of the four simplex corners
-		ii = i & 0xFF;
-		jj = j & 0xFF;
-		kk = k & 0xFF;
-		gi0 = permMod12[ii + perm[jj + perm[kk]]];
-		gi1 = permMod12[ii + ijk12[0] + perm[jj + ijk12[1] + perm[kk + ijk12[2]]]];
-		gi2 = permMod12[ii + ijk12[3] + perm[jj + ijk12[4] + perm[kk + ijk12[5]]]];
-		gi3 = permMod12[ii + 1 + perm[jj + 1 + perm[kk + 1]]];
+		x0 = _mm256_add_ps(_mm256_sub_ps(vx, _mm256_cvtepi32_ps(i)), t);
+		y0 = _mm256_add_ps(_mm256_sub_ps(vy, _mm256_cvtepi32_ps(j)), t);
+		z0 = _mm256_add_ps(_mm256_sub_ps(vz, _mm256_cvtepi32_ps(k)), t);
 		
-		// Calculate the contribution from the four corners
-		t0 = 0.5 - (x0 * x0) - (y0 * y0) - (z0 * z0);
-		t1 = 0.5 - (x1 * x1) - (y1 * y1) - (z1 * z1);
-		t2 = 0.5 - (x2 * x2) - (y2 * y2) - (z2 * z2);
-		t3 = 0.5 - (x3 * x3) - (y3 * y3) - (z3 * z3);
+		// Corner offsets as lane masks
+		xy = _mm256_cmp_ps(x0, y0, _CMP_GE_OQ);
+		xz = _mm256_cmp_ps(x0, z0, _CMP_GE_OQ);
+		yz = _mm256_cmp_ps(y0, z0, _CMP_GE_OQ);
+		i1 = _mm256_and_ps(xy, xz);
+		j1 = _mm256_andnot_ps(xy, yz);
+		k1 = _mm256_andnot_ps(_mm256_or_ps(xz, yz), full);
+		i2 = _mm256_or_ps(xy, xz);
+		j2 = _mm256_andnot_ps(_mm256_andnot_ps(yz, xy), full);
+		k2 = _mm256_andnot_ps(_mm256_and_ps(xz, yz), full);
 		
-		if (t0 < 0) {
-			n0 = 0.0;
-		} else {
-			t0 *= t0;
-			n0 = t0 * t0 * (
-				(grad[gi0][0] * x0) +
-				(grad[gi0][1] * y0) +
-				(grad[gi0][2] * z0)
-			);
-		}
+		ii = _mm256_and_si256(i, wrap);
+		jj = _mm256_and_si256(j, wrap);
+		// jj * PERM_JK_SIZE + kk
+		jk = _mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(jj, 8), jj), _mm256_and_si256(k, wrap));
 		
-		if (t1 < 0) {
-			n1 = 0.0;
-		} else {
-			t1 *= t1;
-			n1 = t1 * t1 * (
-				(grad[gi1][0] * x1) +
-				(grad[gi1][1] * y1) +
-				(grad[gi1][2] * z1)
-			);
-		}
+		n0 = corner_avx2(x0, y0, z0, hash_avx2(table, ii, jk));
+		n1 = corner_avx2(
+			_mm256_add_ps(_mm256_sub_ps(x0, _mm256_and_ps(i1, one)), g3),
+			_mm256_add_ps(_mm256_sub_ps(y0, _mm256_and_ps(j1, one)), g3),
+			_mm256_add_ps(_mm256_sub_ps(z0, _mm256_and_ps(k1, one)), g3),
+			hash_offset_avx2(table, ii, jk, i1, j1, k1)
+		);
+		n2 = corner_avx2(
+			_mm256_add_ps(_mm256_sub_ps(x0, _mm256_and_ps(i2, one)), g3x2),
+			_mm256_add_ps(_mm256_sub_ps(y0, _mm256_and_ps(j2, one)), g3x2),
+			_mm256_add_ps(_mm256_sub_ps(z0, _mm256_and_ps(k2, one)), g3x2),
+			hash_offset_avx2(table, ii, jk, i2, j2, k2)
+		);
+		n3 = corner_avx2(
+			_mm256_sub_ps(x0, half),
+			_mm256_sub_ps(y0, half),
+			_mm256_sub_ps(z0, half),
+			hash_offset_avx2(table, ii, jk, full, full, full)
+		);
 		
-		if (t2 < 0) {
-			n2 = 0.0;
-		} else {
-			t2 *= t2;
-			n2 = t2 * t2 * (
-				(grad[gi2][0] * x2) +
-				(grad[gi2][1] * y2) +
-				(grad[gi2][2] * z2)
-			);
-		}
+		n0 = _mm256_mul_ps(_mm256_set1_ps(32.0f), _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(n0, n1), n2), n3));
+		_mm256_storeu_ps(out + c, _mm256_add_ps(n0, _mm256_setzero_ps()));
+	}
+	noise_scalar(table, x, y, z, dz, first, c, n, out);
+}
+
+#endif
+
+
+/**
+ *  @return The row function of a kernel, nullptr if it cannot run here
+ */
+static NoiseRowFn noise_row_kernel(NoiseKernel kernel) {
+	switch (kernel) {
+#if CPU_X86
+	case NOISE_KERNEL_AVX2:
+		return cpu_has_avx2() ? noise_row_avx2 : nullptr;
+#endif
+#if CPU_SSE2
+	case NOISE_KERNEL_SSE2:
+		return cpu_has_sse2() ? noise_row_sse2 : nullptr;
+#endif
+	case NOISE_KERNEL_SCALAR:
+		return noise_row_scalar;
+	default:
+		return nullptr;
+	}
+}
+
+
+static NoiseRowFn select_noise_row() {
+	if (noise_row_kernel(NOISE_KERNEL_AVX2)) return noise_row_kernel(NOISE_KERNEL_AVX2);
+	if (noise_row_kernel(NOISE_KERNEL_SSE2)) return noise_row_kernel(NOISE_KERNEL_SSE2);
+	return noise_row_scalar;
+}
+
+
+static const NoiseRowFn NOISE_ROW = select_noise_row();
+
+
+void simplex_noise_row(float x, float y, float z, float dz, int n, float *out) {
+	NOISE_ROW(&TABLE, x, y, z, dz, 0, n, out);
+}
+
+
+void simplex_noise_row(NoiseKernel kernel, float x, float y, float z, float dz, int n, float *out) {
+	noise_row_kernel(kernel)(&TABLE, x, y, z, dz, 0, n, out);
+}
+
+
+bool simplex_noise_has_kernel(NoiseKernel kernel) {
+	return noise_row_kernel(kernel) != nullptr;
+}
+
+
+/**
+ *  Sets cells[i] to 1 where values[i] is below the threshold, else 0.
+ */
+static void threshold_row(const float *values, float threshold, int n, uint8_t *cells) {
+	int i = 0;
+	
+#if CPU_SSE2
+	const __m128 limit = _mm_set1_ps(threshold);
+	const __m128i bit = _mm_set1_epi8(1);
+	__m128i a, b, c, d;
+	
+	// Compare masks are 0 or -1, which survive the saturating packs
+	for (; i + 16 <= n; i += 16) {
+		a = _mm_castps_si128(_mm_cmplt_ps(_mm_loadu_ps(values + i     ), limit));
+		b = _mm_castps_si128(_mm_cmplt_ps(_mm_loadu_ps(values + i + 4 ), limit));
+		c = _mm_castps_si128(_mm_cmplt_ps(_mm_loadu_ps(values + i + 8 ), limit));
+		d = _mm_castps_si128(_mm_cmplt_ps(_mm_loadu_ps(values + i + 12), limit));
+		a = _mm_packs_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+		_mm_storeu_si128((__m128i*) (cells + i), _mm_and_si128(a, bit));
+	}
+#endif
+	for (; i < n; i++) {
+		cells[i] = values[i] < threshold;
+	}
+}
+
+
+/**
+ *  Samples a box of lattice points, lattice point (i, j, k) at
+ *  origin + step * (i, j, k), taking every stride-th point from (x, y, z)
+ *  on. Fills values, or thresholds into cells when values is NULL. Rows
+ *  along z are split between the workers, each sample comes out the same
+ *  whichever worker and kernel takes it.
+ *
+ *  z must be a multiple of stride. With stride a power of two, step * stride
+ *  is exact and every sample matches the same lattice point of a box with
+ *  stride 1.
+ */
+static void noise_box(const PermTable *table, const float *origin, float step, int x, int y, int z, int stride,
+                      int size_x, int size_y, int size_z, float *values, uint8_t *cells, ThreadPool *pool) {
+	const int rows = size_x * size_y;
+	
+	auto job = [&](int lo, int hi) {
+		std::vector<float> scratch(values ? 0 : size_z);
+		float *row;
+		int r, i, j;
 		
-		if (t3 < 0) {
-			n3 = 0.0;
-		} else {
-			t3 *= t3;
-			n3 = t3 * t3 * (
-				(grad[gi3][0] * x3) +
-				(grad[gi3][1] * y3) +
-				(grad[gi3][2] * z3)
-			);
+		for (r = lo; r < hi; r++) {
+			i = r / size_y;
+			j = r % size_y;
+			row = values ? values + (size_t) r * size_z : scratch.data();
+			
+			NOISE_ROW(table, origin[0] + step * (float) (x + (stride * i)), origin[1] + step * (float) (y + (stride * j)),
+			          origin[2], step * (float) stride, z / stride, size_z, row);
+			if (!values) threshold_row(row, (float) SIMPLEX_THRESHOLD, size_z, cells + (size_t) r * size_z);
 		}
+	};
+	
+	if (rows <= 0 || size_z <= 0) return;
+	if (!pool || pool->size() == 1) {
+		job(0, rows);
+	} else {
+		pool->split(0, rows, job);
+	}
+}
+
+
+/**
+ *  Shuffles P with a splitmix64 stream, seed 0 leaves it as it is.
+ */
+static void seed_permutation(uint32_t seed, short *p) {
+	uint64_t state = seed;
+	uint64_t r;
+	short swap;
+	int i, j;
+	
+	for (i = 0; i < 256; i++) {
+		p[i] = P[i];
+	}
+	if (seed == 0) return;
+	
+	for (i = 255; i > 0; i--) {
+		state += 0x9E3779B97F4A7C15ull;
+		r = state;
+		r = (r ^ (r >> 30)) * 0xBF58476D1CE4E5B9ull;
+		r = (r ^ (r >> 27)) * 0x94D049BB133111EBull;
+		r ^= r >> 31;
 		
-		// Add contributions from each corner to get the final noise value.
-		// The result is scaled to stay just inside [-1,1]
-		grid->m_cells[c] = (32.0 * (n0 + n1 + n2 + n3)) < -0.1;
-	}}}
+		j = (int) (r % (uint64_t) (i + 1));
+		swap = p[i];
+		p[i] = p[j];
+		p[j] = swap;
+	}
+}
+
+
+void simplex_noise(Grid *grid) {
+	const float origin[3] = {0.0f, 0.0f, 0.0f};
+	
+	noise_box(&TABLE, origin, 1.0f, 0, 0, 0, 1, grid->x, grid->y, grid->z, NULL, grid->m_cells, nullptr);
+	grid->update_bricks();
+}
+
+
+void simplex_noise(DensityGrid *grid) {
+	const float origin[3] = {0.0f, 0.0f, 0.0f};
+	
+	noise_box(&TABLE, origin, 1.0f, 0, 0, 0, 1, grid->x, grid->y, grid->z, grid->m_values, NULL, nullptr);
+}
+
+
+SimplexNoise::SimplexNoise(const NoiseParams &params) {
+	short p[256];
+	
+	seed_permutation(params.seed, p);
+	this->m_table = new PermTable(p);
+	this->m_params = params;
+	
+	// Folding the frequency into the lattice leaves one multiply-add per
+	// coordinate, the same one for every fill
+	this->m_origin[0] = params.origin[0] * params.frequency;
+	this->m_origin[1] = params.origin[1] * params.frequency;
+	this->m_origin[2] = params.origin[2] * params.frequency;
+	this->m_step = params.spacing * params.frequency;
+}
+
+
+SimplexNoise::~SimplexNoise() {
+	delete this->m_table;
+}
+
+
+const NoiseParams &SimplexNoise::params() const {
+	return this->m_params;
+}
+
+
+float SimplexNoise::sample(float x, float y, float z) const {
+	const float f = this->m_params.frequency;
+	
+	return noise_float(this->m_table, x * f, y * f, z * f);
+}
+
+
+float SimplexNoise::sample(float x, float y, float z, vec3 grad) const {
+	const float f = this->m_params.frequency;
+	float n = noise_grad(this->m_table, x * f, y * f, z * f, grad);
+	
+	grad[0] *= f;
+	grad[1] *= f;
+	grad[2] *= f;
+	return n;
+}
+
+
+float SimplexNoise::lattice(int i, int j, int k) const {
+	return noise_float(this->m_table,
+		this->m_origin[0] + this->m_step * (float) i,
+		this->m_origin[1] + this->m_step * (float) j,
+		this->m_origin[2] + this->m_step * (float) k
+	);
+}
+
+
+float SimplexNoise::lattice(float i, float j, float k, vec3 grad) const {
+	const float step = this->m_step;
+	float n = noise_grad(this->m_table,
+		this->m_origin[0] + step * i,
+		this->m_origin[1] + step * j,
+		this->m_origin[2] + step * k,
+		grad
+	);
+	
+	grad[0] *= step;
+	grad[1] *= step;
+	grad[2] *= step;
+	return n;
+}
+
+
+void SimplexNoise::sample(int x, int y, int z, int size_x, int size_y, int size_z, float *out, ThreadPool *pool) const {
+	noise_box(this->m_table, this->m_origin, this->m_step, x, y, z, 1, size_x, size_y, size_z, out, NULL, pool);
+}
+
+
+void SimplexNoise::fill(DensityGrid *grid, int x, int y, int z, ThreadPool *pool) const {
+	noise_box(this->m_table, this->m_origin, this->m_step, x, y, z, 1, grid->x, grid->y, grid->z, grid->m_values, NULL, pool);
+}
+
+
+void SimplexNoise::fill(DensityGrid *grid, int x, int y, int z, int stride, ThreadPool *pool) const {
+	noise_box(this->m_table, this->m_origin, this->m_step, x, y, z, stride, grid->x, grid->y, grid->z, grid->m_values, NULL,
+	          pool);
+}
+
+
+void SimplexNoise::fill(Grid *grid, int x, int y, int z, ThreadPool *pool) const {
+	noise_box(this->m_table, this->m_origin, this->m_step, x, y, z, 1, grid->x, grid->y, grid->z, NULL, grid->m_cells, pool);
+	grid->update_bricks();
+}
+
+
+void SimplexNoise::mesh(int x, int y, int z, int size_x, int size_y, int size_z,
+                        std::vector<Vertex> &vertices, std::vector<unsigned int> &indices,
+                        ThreadPool *pool) const {
+	MarchingCubeGenerator::generate_streamed(size_x, size_y, size_z, SIMPLEX_THRESHOLD,
+		[&](int i, float *slice) {
+			sample(x + i, y, z, 1, size_y, size_z, slice, pool);
+		},
+		[&](const float *p, float *g) {
+			lattice((float) x + p[0], (float) y + p[1], (float) z + p[2], g);
+		},
+		vertices, indices
+	);
+}
+
+
+Mesh *SimplexNoise::mesh(int x, int y, int z, int size_x, int size_y, int size_z, ThreadPool *pool) const {
+	Mesh *mesh = new Mesh();
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	
+	this->mesh(x, y, z, size_x, size_y, size_z, vertices, indices, pool);
+	
+	mesh_create(mesh, vertices.data(), vertices.size(), indices.data(), indices.size());
+	return mesh;
 }
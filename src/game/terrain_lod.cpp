@@ -0,0 +1,202 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#include "terrain_lod.h"
+
+#include <math.h>
+#include <algorithm>
+#include <tuple>
+
+
+bool TerrainChunk::operator<(const TerrainChunk &other) const {
+	return std::tie(this->level, this->x, this->y, this->z, this->transitions) <
+	       std::tie(other.level, other.x, other.y, other.z, other.transitions);
+}
+
+
+TerrainLod::TerrainLod(const DensityBox &fill, const DensityGradient &gradient, float iso,
+                       int size, int levels, int radius) {
+	this->m_fill = fill;
+	this->m_gradient = gradient;
+	this->m_iso = iso;
+	this->m_size = std::max(size, 1);
+	this->m_levels = std::max(levels, 1);
+	
+	// The cube of a level is centered on the grid of the next level, so the
+	// cube inside it can sit up to a chunk off center. 4 chunks still leaves
+	// a whole ring of chunks of the level between the two.
+	this->m_radius = std::max(radius + (radius & 1), 4);
+}
+
+
+TerrainLod::~TerrainLod() {
+	for (auto &entry : this->m_meshes) {
+		release(entry.second);
+	}
+}
+
+
+void TerrainLod::select(const vec3 viewer, std::vector<TerrainChunk> &chunks) const {
+	const int r = this->m_radius;
+	int lo[3], inner[3] = { 0, 0, 0 };
+	int level, span, axis, face, i, j, k;
+	
+	chunks.clear();
+	
+	for (level = 0; level < this->m_levels; level++) {
+		span = this->m_size << level;
+		
+		for (axis = 0; axis < 3; axis++) {
+			lo[axis] = ((int) floorf(viewer[axis] / (float) (2 * span)) * 2 * span) - (r * span);
+		}
+		
+		// Whether the chunk at p lies inside the level before, whose cube has
+		// its corner at inner and is r chunks of this level wide
+		auto finer = [&](const int *p) {
+			if (level == 0) return false;
+			for (int a = 0; a < 3; a++) {
+				if (p[a] < inner[a] || p[a] >= inner[a] + (r * span)) return false;
+			}
+			return true;
+		};
+		
+		for (i = 0; i < 2 * r; i++) {
+			for (j = 0; j < 2 * r; j++) {
+				for (k = 0; k < 2 * r; k++) {
+					TerrainChunk chunk = { level, lo[0] + (i * span), lo[1] + (j * span), lo[2] + (k * span), 0 };
+					int p[3] = { chunk.x, chunk.y, chunk.z };
+					
+					if (finer(p)) continue;
+					
+					for (face = 0; face < 6; face++) {
+						int n[3] = { p[0], p[1], p[2] };
+						n[face >> 1] += (face & 1) ? span : -span;
+						if (finer(n)) chunk.transitions |= 1 << face;
+					}
+					chunks.push_back(chunk);
+				}
+			}
+		}
+		
+		std::copy(lo, lo + 3, inner);
+	}
+}
+
+
+int TerrainLod::build(const vec3 viewer, ThreadPool *pool) {
+	std::vector<TerrainChunk> wanted;
+	std::vector<TerrainChunk> missing;
+	int c, first;
+	
+	select(viewer, wanted);
+	std::sort(wanted.begin(), wanted.end());
+	
+	// Chunks still waiting to be uploaded count as meshed
+	for (const TerrainChunkData &data : this->m_pending) {
+		this->m_meshes.emplace(data.chunk, nullptr);
+	}
+	
+	this->m_stale.clear();
+	for (auto &entry : this->m_meshes) {
+		if (!std::binary_search(wanted.begin(), wanted.end(), entry.first)) this->m_stale.push_back(entry.first);
+	}
+	for (const TerrainChunk &chunk : wanted) {
+		if (!this->m_meshes.count(chunk)) missing.push_back(chunk);
+	}
+	
+	first = (int) this->m_pending.size();
+	this->m_pending.resize(first + missing.size());
+	
+	auto mesh_chunk = [&](int i) {
+		TerrainChunkData &data = this->m_pending[first + i];
+		const TerrainChunk &chunk = missing[i];
+		
+		data.chunk = chunk;
+		MarchingCubeGenerator::generate_lod(chunk.x, chunk.y, chunk.z, this->m_size, 1 << chunk.level, this->m_iso,
+			chunk.transitions, this->m_fill, this->m_gradient, data.vertices, data.indices);
+	};
+	
+	if (pool) {
+		pool->for_each((int) missing.size(), mesh_chunk);
+	} else {
+		for (c = 0; c < (int) missing.size(); c++) {
+			mesh_chunk(c);
+		}
+	}
+	return (int) missing.size();
+}
+
+
+int TerrainLod::upload() {
+	int n = (int) this->m_pending.size();
+	
+	for (TerrainChunkData &data : this->m_pending) {
+		Mesh *mesh = nullptr;
+		
+		if (!data.indices.empty()) {
+			mesh = new Mesh();
+			mesh_create(mesh, data.vertices.data(), data.vertices.size(), data.indices.data(), data.indices.size());
+		}
+		release(this->m_meshes[data.chunk]);
+		this->m_meshes[data.chunk] = mesh;
+	}
+	this->m_pending.clear();
+	
+	// After the pending ones, which may have gone stale before they got here
+	for (const TerrainChunk &chunk : this->m_stale) {
+		auto entry = this->m_meshes.find(chunk);
+		if (entry == this->m_meshes.end()) continue;
+		
+		release(entry->second);
+		this->m_meshes.erase(entry);
+	}
+	this->m_stale.clear();
+	return n;
+}
+
+
+int TerrainLod::update(const vec3 viewer, ThreadPool *pool) {
+	int n = build(viewer, pool);
+	
+	upload();
+	return n;
+}
+
+
+void TerrainLod::render() {
+	for (auto &entry : this->m_meshes) {
+		if (entry.second) mesh_render(entry.second);
+	}
+}
+
+
+int TerrainLod::chunks() const {
+	return (int) this->m_meshes.size();
+}
+
+
+int TerrainLod::reach() const {
+	return this->m_radius * (this->m_size << (this->m_levels - 1));
+}
+
+
+// Private helper functions
+
+void TerrainLod::release(Mesh *mesh) {
+	if (!mesh) return;
+	
+	mesh_delete(mesh);
+	delete mesh;
+}
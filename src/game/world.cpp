@@ -34,17 +34,17 @@ void world_init(World* world, Game* game) {
     world->life = new GameOfLife(20, 20, 20);
     world->life->populate(30);
     world->life->step();
-#else
-    Grid* grid = new Grid(8, 8, 8);
-	simplex_noise(grid);
 #endif
 
 	fprintf(stdout, "WORLD: \t\tGenerating marching cubes...\n");
 #ifdef CONWAY
-    mcube_mesh = MarchingCubeGenerator::generate(world->life->m_current);
+    // Meshes arrive from the worker, the first one holds the whole grid
+    world->life_mesh = new ChunkMesher(world->life->x, world->life->y, world->life->z);
+    world->life_worker = new LifeWorker(world->life);
 #else
-	mcube_mesh = MarchingCubeGenerator::generate(grid);
-	delete grid;
+	// Sampled a plane at a time straight into the mesher, normals come from
+	// the noise gradient
+	mcube_mesh = SimplexNoise().mesh(0, 0, 0, 8, 8, 8);
 #endif
     
     // TEXTURES
@@ -190,11 +190,11 @@ void world_update(World* world, Game* game, double delta) {
     if (life_time >= 1.0f) {
         //printf("%f ", life_time);
         life_time -= 1.0f;
-        world->life->step();
-
-        mesh_delete(mcube_mesh);
-        mcube_mesh = MarchingCubeGenerator::generate(world->life->m_current);
+        world->life_worker->request();
     }
+
+    // Step and remesh happen on the worker, only finished chunks are uploaded
+    world->life_worker->poll(world->life_mesh);
 #endif
 
     quat q;
@@ -224,7 +224,11 @@ void world_scene(World* world) {
     //Shader::push(&world->island);
     transform_to_matrix(&world->cube_t, mat);
     uniform_buffer_store(&world->mvp_mat, 0, sizeof(mat4), mat);
+#ifdef CONWAY
+    world->life_mesh->render();
+#else
     mesh_render(mcube_mesh);
+#endif
     //Shader::pop();
 }
 
@@ -271,7 +275,13 @@ void world_delete(World* world) {
 
     // Meshes
     mesh_delete(&world->frame);
+#ifdef CONWAY
+    delete world->life_worker;
+    delete world->life_mesh;
+#else
     mesh_delete(mcube_mesh);
+    delete mcube_mesh;
+#endif
 
     // Framebuffers
     framebuffer_delete(&world->g_buffer);
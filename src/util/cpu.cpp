@@ -0,0 +1,79 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#include "cpu.h"
+
+
+#if CPU_X86 && defined(_MSC_VER)
+
+static bool cpu_avx_enabled() {
+    int info[4];
+    __cpuid(info, 1);
+    // OSXSAVE and AVX, then check the OS saves the YMM registers
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) return false;
+    return (_xgetbv(0) & 0x6) == 0x6;
+}
+
+bool cpu_has_sse2() {
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+}
+
+bool cpu_has_sse41() {
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 19)) != 0;
+}
+
+bool cpu_has_avx2() {
+    int info[4];
+    if (!cpu_avx_enabled()) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+}
+
+#elif CPU_X86
+
+bool cpu_has_sse2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+}
+
+bool cpu_has_sse41() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1");
+}
+
+bool cpu_has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+#else
+
+bool cpu_has_sse2() {
+    return false;
+}
+
+bool cpu_has_sse41() {
+    return false;
+}
+
+bool cpu_has_avx2() {
+    return false;
+}
+
+#endif
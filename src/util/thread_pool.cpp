@@ -0,0 +1,174 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#include "thread_pool.h"
+
+
+/**
+ *  Pools whose jobs the current thread is inside of, innermost first.
+ */
+struct PoolFrame {
+    const ThreadPool *pool;
+    PoolFrame *up;
+};
+
+static thread_local PoolFrame *t_frames = nullptr;
+
+
+static bool inside(const ThreadPool *pool);
+static void call(const ThreadPool *pool, const std::function<void(int)> &job, int worker);
+
+
+ThreadPool::ThreadPool(int threads) {
+    int i;
+
+    if (threads <= 0) threads = (int) std::thread::hardware_concurrency();
+    if (threads <= 0) threads = 1;
+
+    this->m_job = nullptr;
+    this->m_generation = 0;
+    this->m_pending = 0;
+    this->m_stop = false;
+
+    for (i = 1; i < threads; i++) {
+        this->m_threads.emplace_back(&ThreadPool::worker, this, i);
+    }
+}
+
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(this->m_lock);
+        this->m_stop = true;
+    }
+    this->m_start.notify_all();
+
+    for (std::thread &t : this->m_threads) {
+        t.join();
+    }
+}
+
+
+int ThreadPool::size() const {
+    return (int) this->m_threads.size() + 1;
+}
+
+
+void ThreadPool::run(const std::function<void(int worker)> &job) {
+    int w;
+
+    // Every other worker is busy with the outer job, or waiting on it
+    if (inside(this)) {
+        for (w = 0; w < this->size(); w++) {
+            job(w);
+        }
+        return;
+    }
+
+    if (this->m_threads.empty()) {
+        call(this, job, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(this->m_lock);
+        this->m_job = &job;
+        this->m_pending = (int) this->m_threads.size();
+        this->m_generation++;
+    }
+    this->m_start.notify_all();
+
+    call(this, job, 0);
+
+    std::unique_lock<std::mutex> lock(this->m_lock);
+    this->m_done.wait(lock, [this] { return this->m_pending == 0; });
+    this->m_job = nullptr;
+}
+
+
+void ThreadPool::split(int begin, int end, const std::function<void(int lo, int hi)> &job) {
+    int n = this->size();
+    int len = end - begin;
+
+    if (len <= 0) return;
+    this->run([&](int w) {
+        int lo = begin + (int) (((long long) len * w) / n);
+        int hi = begin + (int) (((long long) len * (w + 1)) / n);
+        if (lo < hi) job(lo, hi);
+    });
+}
+
+
+void ThreadPool::for_each(int n, const std::function<void(int i)> &job) {
+    std::atomic<int> next(0);
+
+    if (n <= 0) return;
+    this->run([&](int) {
+        int i;
+        while ((i = next.fetch_add(1, std::memory_order_relaxed)) < n) {
+            job(i);
+        }
+    });
+}
+
+
+// Private helper functions
+
+void ThreadPool::worker(int id) {
+    unsigned long seen = 0;
+
+    for (;;) {
+        const std::function<void(int)> *job;
+        {
+            std::unique_lock<std::mutex> lock(this->m_lock);
+            this->m_start.wait(lock, [&] { return this->m_stop || this->m_generation != seen; });
+            if (this->m_stop) return;
+            seen = this->m_generation;
+            job = this->m_job;
+        }
+
+        call(this, *job, id);
+
+        {
+            std::lock_guard<std::mutex> guard(this->m_lock);
+            if (--this->m_pending == 0) this->m_done.notify_one();
+        }
+    }
+}
+
+
+/**
+ *  @return Whether the current thread is running a job of pool
+ */
+static bool inside(const ThreadPool *pool) {
+    PoolFrame *frame;
+
+    for (frame = t_frames; frame; frame = frame->up) {
+        if (frame->pool == pool) return true;
+    }
+    return false;
+}
+
+
+/**
+ *  Runs a job of pool as the given worker, marking the thread as inside it.
+ */
+static void call(const ThreadPool *pool, const std::function<void(int)> &job, int worker) {
+    PoolFrame frame = { pool, t_frames };
+
+    t_frames = &frame;
+    job(worker);
+    t_frames = frame.up;
+}
@@ -0,0 +1,270 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+    Steps GameOfLife with step(), step_boxsum() and step_active(), and
+    BitLife, on random grids of odd sizes and on a few live bricks in an
+    empty grid, and checks every generation cell for cell against a brute
+    force count of the (2 * r + 1)^3 box around each cell.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "common.h"
+#include "conway.h"
+#include "testing.h"
+
+
+// Generations stepped per grid, fewer for the slow brute force count of
+// the larger radii
+#define GENERATIONS         (12)
+#define RADIUS_GENERATIONS  (4)
+
+
+enum Mode {
+    MODE_STEP, MODE_BOXSUM, MODE_ACTIVE, MODE_BIT
+};
+
+static const char *NAMES[] = { "step", "boxsum", "active", "bit" };
+
+
+/**
+ *  Steps src into dst by counting every cell of the box around each cell.
+ */
+static void brute_step(Grid *src, Grid *dst, int radius) {
+    int x, y, z, i, j, k, n;
+
+    for (x = 0; x < src->x; x++) {
+        for (y = 0; y < src->y; y++) {
+            for (z = 0; z < src->z; z++) {
+                const uint8_t cell = src->m_cells[src->index(x, y, z)];
+
+                n = 0;
+                for (i = std::max(x - radius, 0); i <= std::min(x + radius, src->x - 1); i++) {
+                    for (j = std::max(y - radius, 0); j <= std::min(y + radius, src->y - 1); j++) {
+                        for (k = std::max(z - radius, 0); k <= std::min(z + radius, src->z - 1); k++) {
+                            n += src->m_cells[src->index(i, j, k)];
+                        }
+                    }
+                }
+                n -= cell;
+
+                dst->m_cells[dst->index(x, y, z)] = cell ? (n >= CONWAY_SURVIVE_LOW && n <= CONWAY_SURVIVE_HIGH) :
+                                                           (n >= CONWAY_BIRTH_LOW && n <= CONWAY_BIRTH_HIGH);
+            }
+        }
+    }
+    dst->update_bricks();
+}
+
+
+/**
+ *  @return Whether two grids of the same size hold the same cells
+ */
+static bool same(Grid *a, Grid *b) {
+    return !memcmp(a->m_cells, b->m_cells, (size_t) a->x * a->y * a->z);
+}
+
+
+/**
+ *  Fills a grid with cells alive at the given percent.
+ */
+static void random_cells(Grid *grid, int percent) {
+    size_t i;
+
+    for (i = 0; i < (size_t) grid->x * grid->y * grid->z; i++) {
+        grid->m_cells[i] = (rand() % 100) < percent;
+    }
+    grid->update_bricks();
+}
+
+
+/**
+ *  Clears a grid but for a few random bricks, so life spreads from the
+ *  bricks that change into still ones across their faces.
+ */
+static void brick_cells(Grid *grid, int percent) {
+    int c, i, j, k, p[3];
+    const int size[3] = { grid->x, grid->y, grid->z };
+
+    memset(grid->m_cells, 0, (size_t) grid->x * grid->y * grid->z);
+    for (c = 0; c < 4; c++) {
+        for (i = 0; i < 3; i++) {
+            p[i] = (rand() % ((size[i] + GRID_BRICK - 1) / GRID_BRICK)) * GRID_BRICK;
+        }
+        for (i = p[0]; i < std::min(p[0] + GRID_BRICK, grid->x); i++) {
+            for (j = p[1]; j < std::min(p[1] + GRID_BRICK, grid->y); j++) {
+                for (k = p[2]; k < std::min(p[2] + GRID_BRICK, grid->z); k++) {
+                    grid->m_cells[grid->index(i, j, k)] = (rand() % 100) < percent;
+                }
+            }
+        }
+    }
+    grid->update_bricks();
+}
+
+
+/**
+ *  Steps a copy of the cells in one mode and the brute force count side by
+ *  side, radius applies to MODE_BOXSUM alone.
+ */
+static int test_mode(Mode mode, Grid *cells, int radius, int generations) {
+    const int x = cells->x, y = cells->y, z = cells->z;
+    Grid expected(x, y, z), actual(x, y, z), temp(x, y, z);
+    GameOfLife life(x, y, z);
+    BitLife bits(x, y, z);
+    int g;
+
+    memcpy(expected.m_cells, cells->m_cells, (size_t) x * y * z);
+    expected.update_bricks();
+
+    // Cells written by hand are picked up by populate(0) and a step()
+    life.populate(0);
+    memcpy(life.m_current->m_cells, cells->m_cells, (size_t) x * y * z);
+    life.m_current->update_bricks();
+    bits.m_current->pack(cells);
+
+    for (g = 0; g < generations; g++) {
+        brute_step(&expected, &temp, mode == MODE_BOXSUM ? radius : 1);
+        memcpy(expected.m_cells, temp.m_cells, (size_t) x * y * z);
+        expected.update_bricks();
+
+        if (mode == MODE_BIT) {
+            bits.step();
+            bits.m_current->unpack(&actual);
+            ASSERT(same(&expected, &actual));
+            continue;
+        }
+
+        if (mode == MODE_STEP || (mode == MODE_ACTIVE && g == 0)) {
+            life.step();
+        } else if (mode == MODE_BOXSUM) {
+            ASSERT(life.step_boxsum(radius) == CODE_SUCCESS);
+        } else {
+            life.step_active();
+        }
+        ASSERT(same(&expected, life.m_current));
+    }
+    return 0;
+}
+
+
+/**
+ *  Random cells and a few live bricks at odd sizes, radius 1.
+ */
+static int test_sizes(Mode mode) {
+    const int sizes[][3] = {
+        { 1, 1, 1 },
+        { 7, 9, 5 },
+        { 17, 8, 23 },
+        { 33, 17, 29 },
+        { 6, 5, 67 },
+        { 40, 3, 41 }
+    };
+    const int percents[] = { 20, 35 };
+
+    for (const int *size : sizes) {
+        Grid cells(size[0], size[1], size[2]);
+
+        for (int percent : percents) {
+            random_cells(&cells, percent);
+            if (test_mode(mode, &cells, 1, GENERATIONS)) return 1;
+            brick_cells(&cells, percent);
+            if (test_mode(mode, &cells, 1, GENERATIONS)) return 1;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ *  Every radius step_boxsum() takes, sparse enough for the counts of the
+ *  larger boxes to land in the ranges now and then.
+ */
+static int test_radii() {
+    Grid cells(13, 11, 15);
+    int radius, span;
+
+    for (radius = 1; radius <= CONWAY_RADIUS_MAX; radius++) {
+        span = (2 * radius) + 1;
+        random_cells(&cells, std::max(600 / (span * span * span), 1));
+        if (test_mode(MODE_BOXSUM, &cells, radius, RADIUS_GENERATIONS)) return 1;
+    }
+
+    GameOfLife life(4, 4, 4);
+    ASSERT(life.step_boxsum(0) == CODE_INDEX_OUT_OF_BOUNDS);
+    ASSERT(life.step_boxsum(CONWAY_RADIUS_MAX + 1) == CODE_INDEX_OUT_OF_BOUNDS);
+    return 0;
+}
+
+
+/**
+ *  Two blocks a cell apart are a still life at radius 1 and crowd each
+ *  other at radius 2. Switching radii must drop the period found and keep
+ *  the cells right when radius 1 resumes.
+ */
+static int test_switch() {
+    GameOfLife life(12, 12, 12);
+    Grid expected(12, 12, 12), temp(12, 12, 12);
+    int g, i, j, k, radius;
+
+    life.populate(0);
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < 2; j++) {
+            for (k = 0; k < 2; k++) {
+                life.m_current->m_cells[life.m_current->index(6 + i, 4 + j, 4 + k)] = 1;
+                life.m_current->m_cells[life.m_current->index(9 + i, 4 + j, 4 + k)] = 1;
+            }
+        }
+    }
+    life.m_current->update_bricks();
+    memcpy(expected.m_cells, life.m_current->m_cells, 12 * 12 * 12);
+
+    for (g = 0; g < 16; g++) {
+        radius = (g == 6) ? 2 : 1;
+        brute_step(&expected, &temp, radius);
+        memcpy(expected.m_cells, temp.m_cells, 12 * 12 * 12);
+
+        ASSERT(life.step_boxsum(radius) == CODE_SUCCESS);
+        ASSERT(same(&expected, life.m_current));
+        if (g > 0 && g < 6) ASSERT(life.period() == 1);
+        if (g == 6) ASSERT(life.period() == 0);
+    }
+    return 0;
+}
+
+
+int main() {
+    int mode;
+
+    srand(8);
+    for (mode = MODE_STEP; mode <= MODE_BIT; mode++) {
+        TEST_START(NAMES[mode]);
+        VERIFY(test_sizes, (Mode) mode);
+        TEST_END();
+    }
+
+    TEST_START("radii");
+    VERIFY_MODULE(test_radii);
+    TEST_END();
+
+    TEST_START("radius switch");
+    VERIFY_MODULE(test_switch);
+    TEST_END();
+    return 0;
+}
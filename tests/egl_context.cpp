@@ -0,0 +1,75 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#include "egl_context.h"
+
+#include <stdio.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glad/glad.h>
+
+#include "common.h"
+
+
+bool egl_context_create() {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC platform_display;
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context;
+    EGLConfig config = NULL;
+    EGLint major, minor, count;
+
+    const EGLint config_attribs[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    const EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, GL_VER_MAJ,
+        EGL_CONTEXT_MINOR_VERSION, GL_VER_MIN,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    // No window system on a CI runner, so ask Mesa for a surfaceless display first
+    platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (platform_display) display = platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        fprintf(stderr, "no EGL display\n");
+        return false;
+    }
+
+    // Surfaceless contexts do not need a config, pass one only if there is one
+    if (!eglChooseConfig(display, config_attribs, &config, 1, &count) || count == 0) config = NULL;
+
+    eglBindAPI(EGL_OPENGL_API);
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+    if (context == EGL_NO_CONTEXT) {
+        fprintf(stderr, "no GL 4.3 core context (EGL error 0x%x)\n", eglGetError());
+        return false;
+    }
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        fprintf(stderr, "cannot make the context current (EGL error 0x%x)\n", eglGetError());
+        return false;
+    }
+    if (!gladLoadGLLoader((GLADloadproc) eglGetProcAddress)) {
+        fprintf(stderr, "cannot load GL\n");
+        return false;
+    }
+
+    printf("GL %s on %s\n", glGetString(GL_VERSION), glGetString(GL_RENDERER));
+    return true;
+}
@@ -0,0 +1,34 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef EGL_CONTEXT_H
+#define EGL_CONTEXT_H
+
+
+// Exit code ctest reports as skipped, for machines without any EGL device
+#define TEST_SKIPPED    (77)
+
+
+/**
+ *  Makes a surfaceless GL 4.3 core context current on the default EGL
+ *  device, e.g. Mesa's llvmpipe on a headless CI runner, and loads glad.
+ *  Prints the renderer on success and the failing step otherwise.
+ *
+ *  @return true if a context is current
+ */
+bool egl_context_create();
+
+
+#endif
@@ -0,0 +1,103 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+    Steps GpuLife on a headless GL context and checks every generation
+    against BitLife, which runs the same rule on the CPU. Sizes cover
+    single cells, rows that end inside a word and thin slabs.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "conway.h"
+#include "gpu_life.h"
+#include "egl_context.h"
+#include "testing.h"
+
+
+/**
+ *  @return Whether two bit grids of the same size hold the same cells
+ */
+static bool same(BitGrid *a, BitGrid *b) {
+    return !memcmp(a->m_words, b->m_words, (size_t) a->x * a->y * a->words * sizeof(uint64_t));
+}
+
+
+/**
+ *  Runs GpuLife next to BitLife for a few single steps and one batch.
+ *
+ *  @param size     x, y and z of the automaton
+ */
+static int test_size(const int *size) {
+    BitLife cpu(size[0], size[1], size[2]);
+    GpuLife gpu(size[0], size[1], size[2]);
+    BitGrid cells(size[0], size[1], size[2]);
+    Grid bytes(size[0], size[1], size[2]);
+    int g;
+
+    ASSERT(gpu.init() == CODE_SUCCESS);
+
+    srand(size[0] + size[1] + size[2]);
+    cpu.populate(30);
+    gpu.load(cpu.m_current);
+
+    for (g = 0; g < 4; g++) {
+        cpu.step();
+        gpu.step();
+        gpu.store(&cells);
+        ASSERT(same(&cells, cpu.m_current));
+    }
+
+    // Several passes queued at once, read back through a byte grid
+    for (g = 0; g < 7; g++) cpu.step();
+    gpu.step(7);
+    gpu.store(&bytes);
+    cells.pack(&bytes);
+    ASSERT(same(&cells, cpu.m_current));
+
+    // And loaded back from one
+    gpu.load(&bytes);
+    cpu.step();
+    gpu.step();
+    gpu.store(&cells);
+    ASSERT(same(&cells, cpu.m_current));
+    return 0;
+}
+
+
+int main() {
+    const int sizes[][3] = {
+        { 60, 50, 100 },
+        { 1, 1, 1 },
+        { 3, 70, 65 },
+        { 33, 2, 64 },
+        { 17, 19, 129 },
+        { 40, 40, 32 }
+    };
+    char name[64];
+
+    if (!egl_context_create()) return TEST_SKIPPED;
+
+    for (const int *size : sizes) {
+        snprintf(name, sizeof(name), "%d x %d x %d", size[0], size[1], size[2]);
+        TEST_START(name);
+        VERIFY(test_size, size);
+        TEST_END();
+    }
+    return 0;
+}
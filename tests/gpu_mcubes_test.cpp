@@ -0,0 +1,177 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+    Meshes on a headless GL context with GpuMarchingCubes and checks the
+    triangles against MarchingCubeGenerator::generate(), reading the cells
+    from the volume texture and straight from a GpuLife. Also covers sizes
+    without a single cell and a capacity that cuts the mesh short.
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "conway.h"
+#include "gpu_life.h"
+#include "gpu_mcubes.h"
+#include "mcubes.h"
+#include "egl_context.h"
+#include "testing.h"
+
+
+// Normals are summed in a different order on the GPU
+#define NORMAL_EPSILON  (1e-5f)
+
+// Enough for every mesh below
+#define CAPACITY        (1 << 20)
+
+
+/**
+ *  @return Whether the first n vertices of two triangle lists agree, n of
+ *          -1 compares them whole
+ */
+static bool same(const std::vector<Vertex> &a, const std::vector<Vertex> &b, int64_t n = -1) {
+    int64_t i;
+    int k;
+
+    if (n < 0) {
+        if (a.size() != b.size()) return false;
+        n = (int64_t) a.size();
+    }
+    if ((int64_t) a.size() < n || (int64_t) b.size() < n) return false;
+
+    for (i = 0; i < n; i++) {
+        if (memcmp(a[i].position, b[i].position, sizeof(a[i].position))) return false;
+        for (k = 0; k < 3; k++) {
+            if (fabsf(a[i].normal[k] - b[i].normal[k]) > NORMAL_EPSILON) return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+ *  Meshes random cells from the volume texture and from a GpuLife, then
+ *  once more after both automata step.
+ *
+ *  @param size     x, y and z of the volume
+ */
+static int test_size(const int *size) {
+    GameOfLife cpu(size[0], size[1], size[2]);
+    GpuLife life(size[0], size[1], size[2]);
+    GpuMarchingCubes mesher(size[0], size[1], size[2], CAPACITY);
+    std::vector<Vertex> expected, actual;
+
+    ASSERT(mesher.init() == CODE_SUCCESS);
+    ASSERT(life.init() == CODE_SUCCESS);
+
+    srand(size[0] + size[1] + size[2]);
+    cpu.populate(30);
+    MarchingCubeGenerator::generate(cpu.m_current, expected);
+
+    mesher.load(cpu.m_current);
+    mesher.generate();
+    mesher.store(actual);
+    ASSERT(mesher.triangles() == (int64_t) expected.size() / 3);
+    ASSERT(same(expected, actual));
+
+    life.load(cpu.m_current);
+    mesher.generate(&life);
+    mesher.store(actual);
+    ASSERT(same(expected, actual));
+
+    // Remeshed without the cells ever coming back to the CPU
+    cpu.step();
+    life.step();
+    MarchingCubeGenerator::generate(cpu.m_current, expected);
+    mesher.generate(&life);
+    mesher.store(actual);
+    ASSERT(same(expected, actual));
+
+    ASSERT(glGetError() == GL_NO_ERROR);
+    return 0;
+}
+
+
+/**
+ *  A capacity below the triangle count keeps the first triangles in
+ *  order and still reports the full count.
+ */
+static int test_capacity() {
+    const int64_t capacities[] = { 0, 1, 1000, 4095 };
+    GameOfLife cpu(40, 40, 40);
+    std::vector<Vertex> expected, actual;
+
+    srand(40);
+    cpu.populate(30);
+    MarchingCubeGenerator::generate(cpu.m_current, expected);
+    ASSERT((int64_t) expected.size() / 3 > 4095);
+
+    for (int64_t capacity : capacities) {
+        GpuMarchingCubes mesher(40, 40, 40, capacity);
+
+        ASSERT(mesher.init() == CODE_SUCCESS);
+        mesher.load(cpu.m_current);
+        mesher.generate();
+        mesher.store(actual);
+
+        ASSERT(mesher.triangles() == (int64_t) expected.size() / 3);
+        ASSERT((int64_t) actual.size() == capacity * 3);
+        ASSERT(same(expected, actual, capacity * 3));
+    }
+
+    // Clamped before anything is allocated
+    ASSERT(GpuMarchingCubes(8, 8, 8, -5).capacity() == 0);
+    ASSERT(GpuMarchingCubes(8, 8, 8, (int64_t) UINT32_MAX + 1).capacity() == GPU_MC_CAPACITY_MAX);
+    ASSERT(GpuMarchingCubes(8, 8, 8, INT64_MAX).capacity() == GPU_MC_CAPACITY_MAX);
+
+    ASSERT(glGetError() == GL_NO_ERROR);
+    return 0;
+}
+
+
+int main() {
+    const int sizes[][3] = {
+        { 8, 8, 8 },
+        { 37, 21, 50 },
+        { 130, 40, 33 },
+        { 64, 64, 64 },
+        // No cells or a single one
+        { 1, 1, 1 },
+        { 1, 5, 5 },
+        { 6, 1, 6 },
+        { 7, 7, 1 },
+        { 2, 2, 2 }
+    };
+    char name[64];
+
+    if (!egl_context_create()) return TEST_SKIPPED;
+
+    for (const int *size : sizes) {
+        snprintf(name, sizeof(name), "%d x %d x %d", size[0], size[1], size[2]);
+        TEST_START(name);
+        VERIFY(test_size, size);
+        TEST_END();
+    }
+
+    TEST_START("capacity");
+    VERIFY_MODULE(test_capacity);
+    TEST_END();
+    return 0;
+}
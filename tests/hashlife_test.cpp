@@ -0,0 +1,145 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+    Advances HashLife one generation and many at a time from random
+    patterns in the middle of a grid and checks the cells against
+    GameOfLife::step(), as long as the pattern keeps clear of the faces
+    where the grid clips it.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "conway.h"
+#include "hashlife.h"
+#include "testing.h"
+
+
+// Edge of the grid and of the random cube in its middle
+#define GRID_SIZE   (48)
+#define SEED_SIZE   (14)
+
+
+/**
+ *  Fills the cube in the middle of a grid with random cells.
+ */
+static void seed(GameOfLife *life, int percent) {
+    const int lo = (GRID_SIZE - SEED_SIZE) / 2;
+    int x, y, z;
+
+    life->populate(0);
+    for (x = lo; x < lo + SEED_SIZE; x++) {
+        for (y = lo; y < lo + SEED_SIZE; y++) {
+            for (z = lo; z < lo + SEED_SIZE; z++) {
+                life->m_current->m_cells[life->m_current->index(x, y, z)] = (rand() % 100) < percent;
+            }
+        }
+    }
+    life->m_current->update_bricks();
+}
+
+
+/**
+ *  @return Whether every cell within two of a face is dead, so nothing
+ *          has been clipped yet
+ */
+static bool clear_of_faces(Grid *grid) {
+    int x, y, z;
+
+    for (x = 0; x < grid->x; x++) {
+        for (y = 0; y < grid->y; y++) {
+            for (z = 0; z < grid->z; z++) {
+                bool face = x < 2 || y < 2 || z < 2 || x >= grid->x - 2 || y >= grid->y - 2 || z >= grid->z - 2;
+                if (face && grid->m_cells[grid->index(x, y, z)]) return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+/**
+ *  @return Number of living cells in a grid
+ */
+static uint64_t count(Grid *grid) {
+    uint64_t n = 0;
+    size_t i;
+
+    for (i = 0; i < (size_t) grid->x * grid->y * grid->z; i++) {
+        n += grid->m_cells[i];
+    }
+    return n;
+}
+
+
+/**
+ *  Advances by each jump in turn and steps GameOfLife as far after each.
+ */
+static int test_jumps(int percent) {
+    const uint64_t jumps[] = { 1, 1, 1, 2, 3, 1, 5, 8, 13, 16, 64, 100, 1000 };
+    GameOfLife life(GRID_SIZE, GRID_SIZE, GRID_SIZE);
+    Grid window(GRID_SIZE, GRID_SIZE, GRID_SIZE), part(20, 9, 31);
+    HashLife hash;
+    uint64_t g, total = 0;
+    int x, y, z;
+
+    seed(&life, percent);
+    hash.load(life.m_current);
+    ASSERT(hash.population() == count(life.m_current));
+
+    for (uint64_t jump : jumps) {
+        for (g = 0; g < jump; g++) {
+            life.step();
+        }
+        hash.advance(jump);
+        total += jump;
+
+        ASSERT(clear_of_faces(life.m_current));
+        ASSERT(hash.generation() == total);
+        ASSERT(hash.population() == count(life.m_current));
+
+        hash.store(&window);
+        ASSERT(!memcmp(window.m_cells, life.m_current->m_cells, (size_t) GRID_SIZE * GRID_SIZE * GRID_SIZE));
+
+        // A window that does not start at the origin
+        hash.store(&part, 17, 5, 9);
+        for (x = 0; x < part.x; x++) {
+            for (y = 0; y < part.y; y++) {
+                for (z = 0; z < part.z; z++) {
+                    ASSERT(part.m_cells[part.index(x, y, z)] ==
+                           life.m_current->m_cells[life.m_current->index(17 + x, 5 + y, 9 + z)]);
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+
+int main() {
+    const int percents[] = { 15, 20, 25 };
+    char name[64];
+
+    srand(12);
+    for (int percent : percents) {
+        snprintf(name, sizeof(name), "%d%%", percent);
+        TEST_START(name);
+        VERIFY(test_jumps, percent);
+        TEST_END();
+    }
+    return 0;
+}
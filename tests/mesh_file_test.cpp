@@ -0,0 +1,123 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+    Writes volumes of random cells to disk in both layouts, meshes them
+    with generate_file() at several slab sizes and checks every file is
+    the mesh generate_indexed() builds in memory, byte for byte.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "mapped_grid.h"
+#include "mcubes.h"
+#include "testing.h"
+
+
+#define VOLUME_PATH "mesh_file_test.raw"
+#define MESH_PATH   "mesh_file_test.mesh"
+
+
+/**
+ *  @return Whether the mesh file at path holds exactly the given mesh
+ */
+static bool same(const char *path, const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices) {
+    MeshFileHeader header;
+    std::vector<Vertex> file_vertices;
+    std::vector<unsigned int> file_indices;
+    FILE *file;
+    bool ok;
+    char extra;
+
+    file = fopen(path, "rb");
+    if (!file) return false;
+
+    ok = fread(&header, sizeof(header), 1, file) == 1;
+    ok = ok && header.magic == MC_FILE_MAGIC && header.vertex_size == sizeof(Vertex);
+    ok = ok && header.vertices == vertices.size() && header.indices == indices.size();
+    if (ok) {
+        file_vertices.resize(vertices.size());
+        file_indices.resize(indices.size());
+        ok = fread(file_vertices.data(), sizeof(Vertex), vertices.size(), file) == vertices.size();
+        ok = ok && fread(file_indices.data(), sizeof(unsigned int), indices.size(), file) == indices.size();
+        ok = ok && fread(&extra, 1, 1, file) == 0;
+    }
+    fclose(file);
+
+    return ok && !memcmp(file_vertices.data(), vertices.data(), vertices.size() * sizeof(Vertex)) &&
+           file_indices == indices;
+}
+
+
+/**
+ *  Meshes one volume from disk in every layout and slab size.
+ */
+static int test_size(const int *size) {
+    const GridLayout layouts[] = { GRID_RAW, GRID_BRICKED };
+    const int slabs[] = { 1, 3, 64 };
+    Grid grid(size[0], size[1], size[2]);
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    MeshFileStats stats;
+    size_t i;
+
+    for (i = 0; i < (size_t) size[0] * size[1] * size[2]; i++) {
+        grid.m_cells[i] = (rand() % 100) < 40;
+    }
+    grid.update_bricks();
+    MarchingCubeGenerator::generate_indexed(&grid, vertices, indices);
+
+    for (GridLayout layout : layouts) {
+        ASSERT(MappedGrid::write(VOLUME_PATH, &grid, layout) == CODE_SUCCESS);
+
+        for (int slab : slabs) {
+            MappedGrid volume;
+
+            ASSERT(volume.open(VOLUME_PATH, size[0], size[1], size[2], layout) == CODE_SUCCESS);
+            ASSERT(MarchingCubeGenerator::generate_file(&volume, MESH_PATH, &stats, slab) == CODE_SUCCESS);
+            ASSERT(stats.vertices == vertices.size() && stats.indices == indices.size());
+            ASSERT(same(MESH_PATH, vertices, indices));
+        }
+    }
+    return 0;
+}
+
+
+int main() {
+    const int sizes[][3] = {
+        { 8, 8, 8 },
+        { 2, 2, 2 },
+        { 37, 21, 50 },
+        { 9, 17, 65 },
+        { 130, 40, 33 }
+    };
+    char name[64];
+
+    srand(22);
+    for (const int *size : sizes) {
+        snprintf(name, sizeof(name), "%d x %d x %d", size[0], size[1], size[2]);
+        TEST_START(name);
+        VERIFY(test_size, size);
+        TEST_END();
+    }
+
+    remove(VOLUME_PATH);
+    remove(MESH_PATH);
+    return 0;
+}
@@ -0,0 +1,335 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+    Checks every simplex noise row kernel the CPU runs against the scalar
+    one, bit for bit, at negative, large and fractional coordinates and
+    row lengths that end partway through a vector. Then checks the box
+    fills of SimplexNoise agree bit for bit across thread counts and
+    overlapping boxes, the analytic gradients against finite differences
+    and the streamed mesh against a mesh of a whole box fill.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "mcubes.h"
+#include "simplex_noise.h"
+#include "testing.h"
+
+
+// Longest row sampled, not a multiple of any vector width
+#define ROW_MAX (203)
+
+// Size of the box the sub-box fills are cut from
+#define BOX_X   (23)
+#define BOX_Y   (17)
+#define BOX_Z   (71)
+
+// Step of the finite differences, in double and in float, and the largest
+// difference from the analytic gradient allowed
+#define DIFF_STEP           (1e-4)
+#define DIFF_STEP_FLOAT     (0.05f)
+#define GRADIENT_EPSILON    (1e-3)
+
+
+struct Row {
+    float x, y, z, dz;
+};
+
+
+static const Row ROWS[] = {
+    { 0.0f, 0.0f, 0.0f, 1.0f },
+    { 0.5f, 0.25f, 0.125f, 0.0625f },
+    { 3.7f, -1.3f, 0.9f, 0.173f },
+    { -12.0f, -7.0f, -99.0f, 1.0f },
+    { -0.001f, -250.75f, -3.3f, 0.41f },
+    { -40960.5f, 1024.25f, -8191.875f, 0.5f },
+    { 98765.0f, 43210.0f, 123456.0f, 1.0f },
+    { 1048576.0f, -524288.0f, 262144.5f, 0.25f },
+    { -2097152.0f, -1048576.0f, -4194304.0f, 2.0f },
+    { 17.3f, 0.0f, -5.0f, -0.37f }
+};
+
+static const char *NAMES[] = { "scalar", "sse2", "avx2" };
+
+
+/**
+ *  Compares every row of one kernel to the scalar kernel and to
+ *  simplex_noise_float().
+ */
+static int test_kernel(NoiseKernel kernel) {
+    float expected[ROW_MAX], actual[ROW_MAX];
+    int r, n, i;
+
+    for (r = 0; r < (int) (sizeof(ROWS) / sizeof(ROWS[0])); r++) {
+        const Row &row = ROWS[r];
+
+        for (n = 1; n <= ROW_MAX; n += (n < 20) ? 1 : 61) {
+            simplex_noise_row(NOISE_KERNEL_SCALAR, row.x, row.y, row.z, row.dz, n, expected);
+            simplex_noise_row(kernel, row.x, row.y, row.z, row.dz, n, actual);
+            ASSERT(!memcmp(expected, actual, n * sizeof(float)));
+
+            for (i = 0; i < n; i++) {
+                float v = simplex_noise_float(row.x, row.y, row.z + row.dz * (float) i);
+                ASSERT(!memcmp(&v, &actual[i], sizeof(float)));
+            }
+        }
+    }
+    return 0;
+}
+
+
+/**
+ *  The kernel picked at startup must be one of them too.
+ */
+static int test_dispatch() {
+    float expected[ROW_MAX], actual[ROW_MAX];
+
+    for (const Row &row : ROWS) {
+        simplex_noise_row(NOISE_KERNEL_SCALAR, row.x, row.y, row.z, row.dz, ROW_MAX, expected);
+        simplex_noise_row(row.x, row.y, row.z, row.dz, ROW_MAX, actual);
+        ASSERT(!memcmp(expected, actual, sizeof(expected)));
+    }
+    return 0;
+}
+
+
+/**
+ *  A box sampled on any number of threads is the one sampled on none.
+ */
+static int test_threads() {
+    const int threads[] = { 1, 2, 3, 4, 7 };
+    NoiseParams params;
+    std::vector<float> expected((size_t) BOX_X * BOX_Y * BOX_Z), actual(expected.size());
+
+    params.seed = 19;
+    params.frequency = 0.07f;
+    params.origin[0] = -3.5f;
+    params.spacing = 0.75f;
+    SimplexNoise noise(params);
+
+    noise.sample(-11, 4, -30, BOX_X, BOX_Y, BOX_Z, expected.data());
+    for (int n : threads) {
+        ThreadPool pool(n);
+
+        noise.sample(-11, 4, -30, BOX_X, BOX_Y, BOX_Z, actual.data(), &pool);
+        ASSERT(!memcmp(expected.data(), actual.data(), expected.size() * sizeof(float)));
+    }
+    return 0;
+}
+
+
+/**
+ *  Boxes that overlap, fills at a stride and single lattice points agree
+ *  wherever they share a lattice point.
+ */
+static int test_boxes() {
+    NoiseParams params;
+    std::vector<float> box((size_t) BOX_X * BOX_Y * BOX_Z), part;
+    ThreadPool pool(3);
+    int b, i, j, k, x0, y0, z0, sx, sy, sz;
+
+    params.seed = 7;
+    params.frequency = 0.11f;
+    SimplexNoise noise(params);
+
+    noise.sample(0, 0, 0, BOX_X, BOX_Y, BOX_Z, box.data());
+    for (b = 0; b < 100; b++) {
+        x0 = rand() % BOX_X;
+        y0 = rand() % BOX_Y;
+        z0 = rand() % BOX_Z;
+        sx = 1 + rand() % (BOX_X - x0);
+        sy = 1 + rand() % (BOX_Y - y0);
+        sz = 1 + rand() % (BOX_Z - z0);
+        part.resize((size_t) sx * sy * sz);
+
+        noise.sample(x0, y0, z0, sx, sy, sz, part.data(), (b & 1) ? &pool : nullptr);
+        for (i = 0; i < sx; i++) {
+            for (j = 0; j < sy; j++) {
+                ASSERT(!memcmp(&part[(((size_t) i * sy) + j) * sz],
+                               &box[(((size_t) (x0 + i) * BOX_Y) + y0 + j) * BOX_Z + z0], sz * sizeof(float)));
+            }
+        }
+    }
+
+    // Every other lattice point, starting on an even z
+    DensityGrid coarse((BOX_X + 1) / 2, (BOX_Y + 1) / 2, (BOX_Z + 1) / 2);
+    noise.fill(&coarse, 0, 0, 0, 2, &pool);
+    for (i = 0; i < coarse.x; i++) {
+        for (j = 0; j < coarse.y; j++) {
+            for (k = 0; k < coarse.z; k++) {
+                const float v = box[(((size_t) (2 * i) * BOX_Y) + (2 * j)) * BOX_Z + (2 * k)];
+                ASSERT(!memcmp(&coarse.m_values[coarse.index(i, j, k)], &v, sizeof(float)));
+            }
+        }
+    }
+
+    for (b = 0; b < 1000; b++) {
+        i = rand() % BOX_X;
+        j = rand() % BOX_Y;
+        k = rand() % BOX_Z;
+        const float v = noise.lattice(i, j, k);
+        ASSERT(!memcmp(&v, &box[(((size_t) i * BOX_Y) + j) * BOX_Z + k], sizeof(float)));
+    }
+    return 0;
+}
+
+
+/**
+ *  @return A random coordinate in [-50:50) with three decimals
+ */
+static float coordinate() {
+    return (float) (rand() % 100000) / 1000.0f - 50.0f;
+}
+
+
+/**
+ *  simplex_noise_grad() against central differences of the double noise,
+ *  and the world and lattice gradients of SimplexNoise against central
+ *  differences of its own samples.
+ */
+static int test_gradient() {
+    const double h = DIFF_STEP;
+    const float hf = DIFF_STEP_FLOAT;
+    NoiseParams params;
+    double diff[3];
+    float x, y, z, v, w;
+    vec3 grad, unused;
+    int t, a;
+
+    params.seed = 20;
+    params.frequency = 0.1f;
+    params.spacing = 0.5f;
+    SimplexNoise noise(params);
+
+    for (t = 0; t < 5000; t++) {
+        x = coordinate();
+        y = coordinate();
+        z = coordinate();
+
+        v = simplex_noise_grad(x, y, z, grad);
+        w = simplex_noise_float(x, y, z);
+        ASSERT(!memcmp(&v, &w, sizeof(float)));
+
+        diff[0] = (simplex_noise(x + h, y, z) - simplex_noise(x - h, y, z)) / (2.0 * h);
+        diff[1] = (simplex_noise(x, y + h, z) - simplex_noise(x, y - h, z)) / (2.0 * h);
+        diff[2] = (simplex_noise(x, y, z + h) - simplex_noise(x, y, z - h)) / (2.0 * h);
+        for (a = 0; a < 3; a++) {
+            ASSERT(fabs(diff[a] - grad[a]) < GRADIENT_EPSILON);
+        }
+
+        v = noise.sample(x, y, z, grad);
+        w = noise.sample(x, y, z);
+        ASSERT(!memcmp(&v, &w, sizeof(float)));
+
+        diff[0] = (noise.sample(x + hf, y, z) - noise.sample(x - hf, y, z)) / (2.0f * hf);
+        diff[1] = (noise.sample(x, y + hf, z) - noise.sample(x, y - hf, z)) / (2.0f * hf);
+        diff[2] = (noise.sample(x, y, z + hf) - noise.sample(x, y, z - hf)) / (2.0f * hf);
+        for (a = 0; a < 3; a++) {
+            ASSERT(fabs(diff[a] - grad[a]) < GRADIENT_EPSILON);
+        }
+
+        noise.lattice(x, y, z, grad);
+        diff[0] = (noise.lattice(x + hf, y, z, unused) - noise.lattice(x - hf, y, z, unused)) / (2.0f * hf);
+        diff[1] = (noise.lattice(x, y + hf, z, unused) - noise.lattice(x, y - hf, z, unused)) / (2.0f * hf);
+        diff[2] = (noise.lattice(x, y, z + hf, unused) - noise.lattice(x, y, z - hf, unused)) / (2.0f * hf);
+        for (a = 0; a < 3; a++) {
+            ASSERT(fabs(diff[a] - grad[a]) < GRADIENT_EPSILON);
+        }
+    }
+    return 0;
+}
+
+
+/**
+ *  mesh() streams the planes of a box through the mesher, the mesh must
+ *  be the one of fill() into a DensityGrid and generate() with the same
+ *  gradient.
+ */
+static int test_mesh() {
+    const int boxes[][6] = {
+        { 0, 0, 0, 32, 32, 32 },
+        { -17, 5, -40, 41, 19, 66 },
+        { 3, -9, 12, 2, 2, 2 },
+        { 100, 200, -300, 9, 50, 13 }
+    };
+    NoiseParams params;
+    std::vector<Vertex> expected_vertices, actual_vertices;
+    std::vector<unsigned int> expected_indices, actual_indices;
+    ThreadPool pool(3);
+
+    params.seed = 21;
+    params.frequency = 0.09f;
+    SimplexNoise noise(params);
+
+    for (const int *box : boxes) {
+        const int x = box[0], y = box[1], z = box[2];
+        DensityGrid grid(box[3], box[4], box[5]);
+
+        noise.fill(&grid, x, y, z);
+        MarchingCubeGenerator::generate(&grid, SIMPLEX_THRESHOLD,
+            [&](const vec3 p, vec3 g) { noise.lattice((float) x + p[0], (float) y + p[1], (float) z + p[2], g); },
+            expected_vertices, expected_indices);
+
+        for (ThreadPool *p : { (ThreadPool*) nullptr, &pool }) {
+            noise.mesh(x, y, z, box[3], box[4], box[5], actual_vertices, actual_indices, p);
+            ASSERT(actual_vertices.size() == expected_vertices.size());
+            ASSERT(!memcmp(actual_vertices.data(), expected_vertices.data(), expected_vertices.size() * sizeof(Vertex)));
+            ASSERT(actual_indices == expected_indices);
+        }
+    }
+    return 0;
+}
+
+
+int main() {
+    int kernel;
+
+    for (kernel = NOISE_KERNEL_SCALAR; kernel <= NOISE_KERNEL_AVX2; kernel++) {
+        TEST_START(NAMES[kernel]);
+        if (!simplex_noise_has_kernel((NoiseKernel) kernel)) {
+            printf("\tSKIP\n");
+            continue;
+        }
+        VERIFY(test_kernel, (NoiseKernel) kernel);
+        TEST_END();
+    }
+
+    TEST_START("dispatch");
+    VERIFY_MODULE(test_dispatch);
+    TEST_END();
+
+    srand(19);
+    TEST_START("threads");
+    VERIFY_MODULE(test_threads);
+    TEST_END();
+
+    TEST_START("boxes");
+    VERIFY_MODULE(test_boxes);
+    TEST_END();
+
+    TEST_START("gradient");
+    VERIFY_MODULE(test_gradient);
+    TEST_END();
+
+    TEST_START("mesh");
+    VERIFY_MODULE(test_mesh);
+    TEST_END();
+    return 0;
+}
@@ -0,0 +1,177 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+    Meshes every chunk around a viewer, welds the chunks by exact vertex
+    position and checks the surface has no open edges away from the outer
+    bounds, i.e. the transition cells close every seam between levels.
+    Also builds with a density fill that shares the worker pool.
+*/
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <utility>
+
+#include "simplex_noise.h"
+#include "terrain_lod.h"
+#include "testing.h"
+
+
+// Cells per chunk edge and levels of the test terrain, small to keep it fast
+#define TEST_SIZE   (8)
+#define TEST_LEVELS (3)
+
+// Added to the noise per lattice step up, so the surface is a bumpy floor
+#define TEST_SLOPE  (0.02f)
+
+
+static SimplexNoise noise(NoiseParams { 3, 0.04f });
+
+
+static void fill(int x, int y, int z, int stride, DensityGrid *grid, ThreadPool *pool) {
+    int i, j, k;
+
+    noise.fill(grid, x, y, z, stride, pool);
+    for (i = 0; i < grid->x; i++) {
+        for (j = 0; j < grid->y; j++) {
+            for (k = 0; k < grid->z; k++) {
+                grid->m_values[grid->index(i, j, k)] += (float) (y + (stride * j)) * TEST_SLOPE;
+            }
+        }
+    }
+}
+
+
+static void gradient(const vec3 p, vec3 grad) {
+    noise.lattice(p[0], p[1], p[2], grad);
+    grad[1] += TEST_SLOPE;
+}
+
+
+/**
+ *  Meshes the chunks and counts the edges used by one triangle only that do
+ *  not lie on a face of the box around all of them.
+ *
+ *  @param mask     Transition faces kept of each chunk, 0 meshes plain cells
+ */
+static long open_edges(const std::vector<TerrainChunk> &chunks, int mask) {
+    std::map<std::array<float, 3>, int> weld;
+    std::map<std::pair<int, int>, int> edges;
+    std::vector<std::array<float, 3>> positions;
+    float lo[3] = { 0.0f, 0.0f, 0.0f }, hi[3] = { 0.0f, 0.0f, 0.0f };
+    long open = 0;
+    size_t t;
+    int a, j, w[3];
+    bool first = true;
+
+    DensityBox box = [](int x, int y, int z, int stride, DensityGrid *grid) { fill(x, y, z, stride, grid, nullptr); };
+
+    for (const TerrainChunk &chunk : chunks) {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        const int corner[3] = { chunk.x, chunk.y, chunk.z };
+        const int span = TEST_SIZE << chunk.level;
+
+        MarchingCubeGenerator::generate_lod(chunk.x, chunk.y, chunk.z, TEST_SIZE, 1 << chunk.level, 0.0f,
+                                            chunk.transitions & mask, box, gradient, vertices, indices);
+
+        for (a = 0; a < 3; a++) {
+            lo[a] = first ? (float) corner[a] : std::min(lo[a], (float) corner[a]);
+            hi[a] = first ? (float) (corner[a] + span) : std::max(hi[a], (float) (corner[a] + span));
+        }
+        first = false;
+
+        for (t = 0; t < indices.size(); t += 3) {
+            for (j = 0; j < 3; j++) {
+                const float *p = vertices[indices[t + j]].position;
+                auto it = weld.emplace(std::array<float, 3> { p[0], p[1], p[2] }, (int) weld.size()).first;
+                w[j] = it->second;
+            }
+            if (w[0] == w[1] || w[1] == w[2] || w[2] == w[0]) continue;
+
+            for (j = 0; j < 3; j++) {
+                edges[{ w[j], w[(j + 1) % 3] }]++;
+            }
+        }
+    }
+
+    positions.resize(weld.size());
+    for (auto &entry : weld) {
+        positions[entry.second] = entry.first;
+    }
+
+    for (auto &edge : edges) {
+        const std::array<float, 3> &p = positions[edge.first.first], &q = positions[edge.first.second];
+        bool bound = false;
+
+        if (edges.count({ edge.first.second, edge.first.first })) continue;
+
+        for (a = 0; a < 3; a++) {
+            if ((p[a] == lo[a] && q[a] == lo[a]) || (p[a] == hi[a] && q[a] == hi[a])) bound = true;
+        }
+        if (!bound) open++;
+    }
+    return open;
+}
+
+
+/**
+ *  Seams between levels must close, and must open without the transition
+ *  cells, or the check finds nothing.
+ */
+static int test_seams() {
+    TerrainLod lod([](int x, int y, int z, int stride, DensityGrid *grid) { fill(x, y, z, stride, grid, nullptr); },
+                   gradient, 0.0f, TEST_SIZE, TEST_LEVELS);
+    std::vector<TerrainChunk> chunks;
+    vec3 viewer = { 3.0f, 1.0f, 5.0f };
+
+    lod.select(viewer, chunks);
+    ASSERT(!chunks.empty());
+    ASSERT(open_edges(chunks, ~0) == 0);
+    ASSERT(open_edges(chunks, 0) > 0);
+    return 0;
+}
+
+
+/**
+ *  A fill that samples on the same pool the chunks are meshed on must not
+ *  wait on itself.
+ */
+static int test_nested_pool() {
+    ThreadPool pool(4);
+    TerrainLod lod([&pool](int x, int y, int z, int stride, DensityGrid *grid) { fill(x, y, z, stride, grid, &pool); },
+                   gradient, 0.0f, TEST_SIZE, TEST_LEVELS);
+    std::vector<TerrainChunk> chunks;
+    vec3 viewer = { 3.0f, 1.0f, 5.0f };
+
+    lod.select(viewer, chunks);
+    ASSERT(lod.build(viewer, &pool) == (int) chunks.size());
+    ASSERT(lod.build(viewer, &pool) == 0);
+    return 0;
+}
+
+
+int main() {
+    TEST_START("seams");
+    VERIFY_MODULE(test_seams);
+    TEST_END();
+
+    TEST_START("nested pool");
+    VERIFY_MODULE(test_nested_pool);
+    TEST_END();
+    return 0;
+}
@@ -0,0 +1,391 @@
+/*
+    Copyright 2020 Carson Clarke-Magrab
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+    Headless batch runner: steps GameOfLife and runs the noise + marching
+    cubes pipeline without a window or GL context, then prints the
+    throughput as JSON on stdout.
+
+        DaybreakBatch [--size N | --dims X Y Z] [--generations G] [--seed S]
+                      [--threads T] [--percent P] [--mode MODE | --rule RULE] [--no-mesh]
+        DaybreakBatch --volume FILE --dims X Y Z [--layout LAYOUT] [--out MESH]
+
+    MODE is one of step, active, boxsum, bit or hashlife. RULE names one of
+    the rules of automaton_rules() and steps it instead of MODE. S seeds both
+    the first generation and the noise. The second form meshes a memory
+    mapped volume file out of core instead, LAYOUT is raw or bricked and
+    MESH defaults to FILE.mesh.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <automaton.h>
+#include <conway.h>
+#include <hashlife.h>
+#include <mapped_grid.h>
+#include <mcubes.h>
+#include <simplex_noise.h>
+#include <thread_pool.h>
+
+typedef std::chrono::steady_clock Clock;
+
+
+struct BatchOptions {
+    int x, y, z;
+    int generations;
+    unsigned int seed;
+    int threads;
+    int percent;
+    const char* mode;
+    const char* rule;
+    bool mesh;
+    const char* volume;
+    const char* out;
+    GridLayout layout;
+};
+
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+
+/**
+ *  @return Peak resident set size of the process in kilobytes
+ */
+static long peak_rss_kb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return (long) (counters.PeakWorkingSetSize / 1024);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+
+static void usage(const char* name) {
+    const AutomatonRule* rules;
+    int i, count;
+
+    fprintf(stderr, "usage: %s [--size N | --dims X Y Z] [--generations G] [--seed S]\n"
+                    "       [--threads T] [--percent P] [--mode step|active|boxsum|bit|hashlife | --rule RULE] [--no-mesh]\n"
+                    "       %s --volume FILE --dims X Y Z [--layout raw|bricked] [--out MESH]\n", name, name);
+
+    rules = automaton_rules(&count);
+    fprintf(stderr, "rules:");
+    for (i = 0; i < count; i++) {
+        fprintf(stderr, " %s", rules[i].name);
+    }
+    fprintf(stderr, "\n");
+}
+
+
+/**
+ *  @return Whether name is one of the rules of automaton_rules()
+ */
+static bool known_rule(const char* name) {
+    const AutomatonRule* rules;
+    int i, count;
+
+    rules = automaton_rules(&count);
+    for (i = 0; i < count; i++) {
+        if (!strcmp(rules[i].name, name)) return true;
+    }
+    return false;
+}
+
+
+static bool parse(int argc, char** argv, BatchOptions* opt) {
+    int i;
+
+    opt->x = opt->y = opt->z = 64;
+    opt->generations = 100;
+    opt->seed = 1;
+    opt->threads = 1;
+    opt->percent = 30;
+    opt->mode = "step";
+    opt->rule = NULL;
+    opt->mesh = true;
+    opt->volume = NULL;
+    opt->out = NULL;
+    opt->layout = GRID_RAW;
+
+    for (i = 1; i < argc; i++) {
+        bool more = i + 1 < argc;
+
+        if (!strcmp(argv[i], "--size") && more) {
+            opt->x = opt->y = opt->z = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--dims") && i + 3 < argc) {
+            opt->x = atoi(argv[++i]);
+            opt->y = atoi(argv[++i]);
+            opt->z = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--generations") && more) {
+            opt->generations = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && more) {
+            opt->seed = (unsigned int) strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--threads") && more) {
+            opt->threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--percent") && more) {
+            opt->percent = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--mode") && more) {
+            opt->mode = argv[++i];
+        } else if (!strcmp(argv[i], "--rule") && more) {
+            opt->rule = argv[++i];
+        } else if (!strcmp(argv[i], "--no-mesh")) {
+            opt->mesh = false;
+        } else if (!strcmp(argv[i], "--volume") && more) {
+            opt->volume = argv[++i];
+        } else if (!strcmp(argv[i], "--out") && more) {
+            opt->out = argv[++i];
+        } else if (!strcmp(argv[i], "--layout") && more) {
+            i++;
+            if (!strcmp(argv[i], "raw")) opt->layout = GRID_RAW;
+            else if (!strcmp(argv[i], "bricked")) opt->layout = GRID_BRICKED;
+            else return false;
+        } else {
+            return false;
+        }
+    }
+
+    if (opt->x <= 0 || opt->y <= 0 || opt->z <= 0 || opt->generations < 0) return false;
+    if (!Grid::fits(opt->x, opt->y, opt->z)) return false;
+    if (opt->rule) return known_rule(opt->rule);
+    return !strcmp(opt->mode, "step") || !strcmp(opt->mode, "active") || !strcmp(opt->mode, "boxsum") ||
+           !strcmp(opt->mode, "bit") || !strcmp(opt->mode, "hashlife");
+}
+
+
+/**
+ *  Meshes a mapped volume file into a mesh file and reports the throughput.
+ *
+ *  @return Exit code of the process
+ */
+static int run_volume(const BatchOptions* opt) {
+    MappedGrid volume;
+    MeshFileStats stats;
+    std::string out = opt->out ? opt->out : std::string(opt->volume) + ".mesh";
+    int code;
+
+    code = volume.open(opt->volume, opt->x, opt->y, opt->z, opt->layout);
+    if (code != CODE_SUCCESS) {
+        fprintf(stderr, "cannot map %s as a %d x %d x %d volume (%d)\n", opt->volume, opt->x, opt->y, opt->z, code);
+        return 1;
+    }
+
+    code = MarchingCubeGenerator::generate_file(&volume, out.c_str(), &stats);
+    if (code != CODE_SUCCESS) {
+        fprintf(stderr, "cannot write %s (%d)\n", out.c_str(), code);
+        return 1;
+    }
+
+    printf("{\n");
+    printf("  \"dims\": [%d, %d, %d],\n", opt->x, opt->y, opt->z);
+    printf("  \"layout\": \"%s\",\n", opt->layout == GRID_RAW ? "raw" : "bricked");
+    printf("  \"out_of_core\": {\n");
+    printf("    \"seconds\": %.6f,\n", stats.seconds);
+    printf("    \"megabytes\": %.1f,\n", stats.megabytes);
+    printf("    \"mb_per_second\": %.1f,\n", stats.mb_per_second);
+    printf("    \"vertices\": %llu,\n", (unsigned long long) stats.vertices);
+    printf("    \"triangles\": %llu\n", (unsigned long long) (stats.indices / 3));
+    printf("  },\n");
+    printf("  \"peak_rss_kb\": %ld\n", peak_rss_kb());
+    printf("}\n");
+    return 0;
+}
+
+
+/**
+ *  Fills a grid with the first generation GameOfLife::populate() draws
+ *  from the seed, without the two grids of a GameOfLife.
+ */
+static void populate(const BatchOptions* opt, Grid* grid) {
+    size_t i;
+
+    srand(opt->seed);
+    for (i = 0; i < (size_t) opt->x * opt->y * opt->z; i++) {
+        grid->m_cells[i] = (rand() % 100) < opt->percent;
+    }
+    grid->update_bricks();
+}
+
+
+/**
+ *  Runs the automaton in the requested mode, or the requested rule, and
+ *  leaves the last generation in out. Only the automaton being stepped is
+ *  allocated next to out, so the peak RSS of a mode is not inflated by the
+ *  two grids of a GameOfLife it never steps.
+ *
+ *  @return Seconds spent stepping, setup and conversions excluded
+ */
+static double run_life(const BatchOptions* opt, ThreadPool* pool, Grid* out) {
+    Clock::time_point start;
+    double elapsed;
+    int g;
+
+    if (opt->rule) {
+        CellularAutomaton* rule = automaton_create(opt->rule, opt->x, opt->y, opt->z);
+        populate(opt, out);
+        rule->load(out);
+
+        start = Clock::now();
+        for (g = 0; g < opt->generations; g++) rule->step();
+        elapsed = seconds_since(start);
+
+        rule->store(out);
+        delete rule;
+        return elapsed;
+    }
+
+    if (!strcmp(opt->mode, "bit")) {
+        BitLife bits(opt->x, opt->y, opt->z);
+        srand(opt->seed);
+        bits.populate(opt->percent);
+
+        start = Clock::now();
+        for (g = 0; g < opt->generations; g++) bits.step();
+        elapsed = seconds_since(start);
+
+        bits.m_current->unpack(out);
+        return elapsed;
+    }
+
+    if (!strcmp(opt->mode, "hashlife")) {
+        HashLife hash;
+        populate(opt, out);
+        hash.load(out);
+
+        start = Clock::now();
+        hash.advance((uint64_t) opt->generations);
+        elapsed = seconds_since(start);
+
+        hash.store(out);
+        return elapsed;
+    }
+
+    GameOfLife life(opt->x, opt->y, opt->z, pool, true);
+    srand(opt->seed);
+    life.populate(opt->percent);
+
+    start = Clock::now();
+    for (g = 0; g < opt->generations; g++) {
+        if (!strcmp(opt->mode, "active")) life.step_active();
+        else if (!strcmp(opt->mode, "boxsum")) life.step_boxsum();
+        else life.step();
+    }
+    elapsed = seconds_since(start);
+
+    memcpy(out->m_cells, life.m_current->m_cells, (size_t) opt->x * opt->y * opt->z);
+    out->update_bricks();
+    return elapsed;
+}
+
+
+int main(int argc, char** argv) {
+    BatchOptions opt;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    double life_s, noise_s = 0.0, mesh_s = 0.0, life_mesh_s = 0.0;
+    size_t noise_tris = 0, life_tris = 0;
+    Clock::time_point start;
+
+    if (!parse(argc, argv, &opt)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (opt.volume) return run_volume(&opt);
+
+    ThreadPool pool(opt.threads);
+    Grid* out = new Grid(opt.x, opt.y, opt.z);
+    const double cells = (double) opt.x * opt.y * opt.z;
+
+    life_s = run_life(&opt, &pool, out);
+
+    if (opt.mesh) {
+        start = Clock::now();
+        MarchingCubeGenerator::generate_indexed(out, vertices, indices);
+        life_mesh_s = seconds_since(start);
+        life_tris = indices.size() / 3;
+
+        NoiseParams params;
+        params.seed = opt.seed;
+        SimplexNoise noise(params);
+
+        DensityGrid* density = new DensityGrid(opt.x, opt.y, opt.z);
+        start = Clock::now();
+        noise.fill(density, 0, 0, 0, &pool);
+        noise_s = seconds_since(start);
+
+        start = Clock::now();
+        MarchingCubeGenerator::generate(density, SIMPLEX_THRESHOLD, vertices, indices, &pool);
+        mesh_s = seconds_since(start);
+        noise_tris = indices.size() / 3;
+        delete density;
+    }
+
+    printf("{\n");
+    printf("  \"dims\": [%d, %d, %d],\n", opt.x, opt.y, opt.z);
+    if (opt.rule) printf("  \"rule\": \"%s\",\n", opt.rule);
+    else printf("  \"mode\": \"%s\",\n", opt.mode);
+    printf("  \"generations\": %d,\n", opt.generations);
+    printf("  \"seed\": %u,\n", opt.seed);
+    printf("  \"threads\": %d,\n", pool.size());
+    printf("  \"life\": {\n");
+    printf("    \"seconds\": %.6f,\n", life_s);
+    printf("    \"cells_per_second\": %.1f,\n", life_s > 0.0 ? (cells * opt.generations) / life_s : 0.0);
+    printf("    \"generations_per_second\": %.3f,\n", life_s > 0.0 ? opt.generations / life_s : 0.0);
+    printf("    \"population\": %ld\n", out->count());
+    printf("  },\n");
+    if (opt.mesh) {
+        printf("  \"life_mesh\": {\n");
+        printf("    \"seconds\": %.6f,\n", life_mesh_s);
+        printf("    \"cells_per_second\": %.1f,\n", life_mesh_s > 0.0 ? cells / life_mesh_s : 0.0);
+        printf("    \"triangles\": %zu\n", life_tris);
+        printf("  },\n");
+        printf("  \"noise\": {\n");
+        printf("    \"seconds\": %.6f,\n", noise_s);
+        printf("    \"cells_per_second\": %.1f\n", noise_s > 0.0 ? cells / noise_s : 0.0);
+        printf("  },\n");
+        printf("  \"noise_mesh\": {\n");
+        printf("    \"seconds\": %.6f,\n", mesh_s);
+        printf("    \"cells_per_second\": %.1f,\n", mesh_s > 0.0 ? cells / mesh_s : 0.0);
+        printf("    \"triangles\": %zu\n", noise_tris);
+        printf("  },\n");
+    }
+    printf("  \"peak_rss_kb\": %ld\n", peak_rss_kb());
+    printf("}\n");
+
+    delete out;
+    return 0;
+}